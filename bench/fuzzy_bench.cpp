@@ -0,0 +1,94 @@
+// Throughput of FuzzyMatcher over a synthetic 1M-entry library, once per
+// kernel the CPU supports. Build with -DEASYINFODROP_BUILD_BENCHMARKS=ON and
+// run build/fuzzy_bench [entries].
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/fuzzy_matcher.h"
+
+namespace {
+
+struct Library {
+    std::string text;                  // Entries back to back
+    std::vector<std::size_t> offsets;  // entries + 1 boundaries
+    std::vector<std::uint64_t> masks;
+};
+
+Library makeLibrary(std::size_t entries) {
+    static const char* const words[] = {
+        "address", "home", "work", "email", "phone", "street", "city", "zip", "note", "kubernetes",
+        "upgrade", "cluster", "cover", "letter", "signature", "john", "doe", "meeting", "invoice", "account",
+        "password", "hint", "project", "deadline", "review", "draft", "summary", "link", "server", "backup"};
+    const std::size_t wordCount = sizeof(words) / sizeof(words[0]);
+    std::mt19937 rng(42);
+    Library library;
+    library.offsets.reserve(entries + 1);
+    library.masks.reserve(entries);
+    for (std::size_t i = 0; i < entries; ++i) {
+        std::size_t start = library.text.size();
+        library.offsets.push_back(start);
+        std::string entry = std::string(words[rng() % wordCount]) + "-" + words[rng() % wordCount];
+        entry += '\0';
+        int valueWords = 3 + static_cast<int>(rng() % 12);
+        for (int w = 0; w < valueWords; ++w) {
+            entry += words[rng() % wordCount];
+            entry += ' ';
+        }
+        entry += std::to_string(i);
+        library.text += entry;
+        library.masks.push_back(FuzzyMatcher::charMask(library.text.data() + start, library.text.size() - start));
+    }
+    library.offsets.push_back(library.text.size());
+    return library;
+}
+
+void run(const Library& library, FuzzyMatcher::Kernel kernel, const char* pattern) {
+    FuzzyMatcher matcher(pattern, kernel);
+    const std::size_t entries = library.masks.size();
+    TopK<std::size_t> top(100);
+    std::size_t matches = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < entries; ++i) {
+        if (!matcher.mayMatch(library.masks[i])) {
+            continue;
+        }
+        const char* text = library.text.data() + library.offsets[i];
+        int score = matcher.score(text, library.offsets[i + 1] - library.offsets[i]);
+        if (score >= 0) {
+            ++matches;
+            top.push(score, i);
+        }
+    }
+    std::vector<std::pair<int, std::size_t>> best = top.take();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("%-7s %-12s %8zu matches  %7.1f ms  %7.2f M entries/s  %7.2f M matches/s  best %d\n",
+                FuzzyMatcher::kernelName(kernel), pattern, matches, seconds * 1e3, entries / seconds / 1e6,
+                matches / seconds / 1e6, best.empty() ? -1 : best.front().first);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    Library library = makeLibrary(entries);
+    std::printf("%zu entries, %zu bytes; best kernel: %s\n", entries, library.text.size(),
+                FuzzyMatcher::kernelName(FuzzyMatcher::bestKernel()));
+    const char* patterns[] = {"e", "adr", "kubupg", "coverletter", "xyzzy"};
+    std::vector<FuzzyMatcher::Kernel> kernels = {FuzzyMatcher::Kernel::Scalar};
+    if (FuzzyMatcher::bestKernel() != FuzzyMatcher::Kernel::Scalar) {
+        kernels.push_back(FuzzyMatcher::Kernel::Sse2);
+    }
+    if (FuzzyMatcher::bestKernel() == FuzzyMatcher::Kernel::Avx2) {
+        kernels.push_back(FuzzyMatcher::Kernel::Avx2);
+    }
+    for (const char* pattern : patterns) {
+        for (FuzzyMatcher::Kernel kernel : kernels) {
+            run(library, kernel, pattern);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "entry_store.h"
+#include "fuzzy_matcher.h"
+
+// Full-text index over entry values with Okapi BM25 ranking, for finding
+// notes by the words in them rather than by an exact substring.
+//
+// Values are split into words of their SearchKey. Each word has a posting list of
+// (document, term frequency) pairs stored as varints, documents as the gap
+// from the previous one, so a list costs about two bytes per posting.
+// As in TrigramIndex documents are only appended, which keeps the gaps
+// positive: replacing or removing an entry leaves a dead document, and the
+// lists are rewritten without them once dead documents outnumber live ones.
+// Dead documents still count towards the collection statistics until then.
+class Bm25Index {
+public:
+    using EntryId = EntryStore::EntryId;
+
+    static constexpr float k1 = 1.2f;
+    static constexpr float b = 0.75f;
+
+    void clear() { *this = Bm25Index(); }
+
+    std::size_t size() const { return docOf.size(); }
+
+    // Indexes the SearchKey of a value under id, replacing what was indexed
+    // under id before.
+    void add(EntryId id, std::string_view valueKey) {
+        remove(id);
+        std::uint32_t number = static_cast<std::uint32_t>(docs.size());
+        counts.clear();
+        std::uint32_t length = 0;
+        forEachWord(valueKey, [&](std::string&& word) {
+            ++counts[std::move(word)];
+            ++length;
+        });
+        for (auto& count : counts) {
+            Postings& list = postings[count.first];
+            putVarint(list.bytes, number - list.lastDoc);
+            putVarint(list.bytes, count.second);
+            list.lastDoc = number;
+            ++list.count;
+        }
+        docs.push_back({id, length, true});
+        docOf[id] = number;
+        totalLength += length;
+    }
+
+    void remove(EntryId id) {
+        auto it = docOf.find(id);
+        if (it == docOf.end()) {
+            return;
+        }
+        docs[it->second].live = false;
+        docOf.erase(it);
+        ++deadDocs;
+        if (deadDocs > 1024 && deadDocs > docOf.size()) {
+            compact();
+        }
+    }
+
+    // The limit best-scoring entries for the words of query, a SearchKey,
+    // best first. Entries need not contain every word.
+    std::vector<EntryId> search(std::string_view query, std::size_t limit) const {
+        return search(query, limit, [](EntryId) { return true; }, [](EntryId) { return 0.0f; });
+    }
+
+    // As above, among the entries for which accept(id) is true, with
+    // boost(id) added to each entry's score.
+    template <typename Accept, typename Boost>
+    std::vector<EntryId> search(std::string_view query, std::size_t limit, Accept&& accept, Boost&& boost) const {
+        std::vector<EntryId> result;
+        if (docs.empty()) {
+            return result;
+        }
+        std::unordered_set<std::string> words;
+        forEachWord(query, [&](std::string&& word) { words.insert(std::move(word)); });
+        const float collection = static_cast<float>(docs.size());
+        const float averageLength = std::max(1.0f, static_cast<float>(totalLength) / collection);
+        // Dense accumulators: common words touch most documents.
+        std::vector<float> scores(docs.size(), 0.0f);
+        std::vector<std::uint32_t> touched;
+        for (const std::string& word : words) {
+            auto it = postings.find(word);
+            if (it == postings.end()) {
+                continue;
+            }
+            const Postings& list = it->second;
+            const float df = static_cast<float>(list.count);
+            const float idf = std::log(1.0f + (collection - df + 0.5f) / (df + 0.5f));
+            const std::uint8_t* p = list.bytes.data();
+            const std::uint8_t* end = p + list.bytes.size();
+            std::uint32_t number = 0;
+            while (p != end) {
+                number += getVarint(p);
+                const float tf = static_cast<float>(getVarint(p));
+                const Doc& doc = docs[number];
+                if (!doc.live) {
+                    continue;
+                }
+                const float norm = k1 * (1.0f - b + b * static_cast<float>(doc.length) / averageLength);
+                if (scores[number] == 0.0f) {
+                    touched.push_back(number);
+                }
+                scores[number] += idf * tf * (k1 + 1.0f) / (tf + norm);
+            }
+        }
+        TopK<std::uint32_t, float> best(limit);
+        for (std::uint32_t number : touched) {
+            if (accept(docs[number].id)) {
+                best.push(scores[number] + boost(docs[number].id), number);
+            }
+        }
+        for (const auto& match : best.take()) {
+            result.push_back(docs[match.second].id);
+        }
+        return result;
+    }
+
+    // Calls f(word) for each run of letters and digits in key.
+    template <typename F>
+    static void forEachWord(std::string_view key, F&& f) {
+        std::string word;
+        for (std::size_t i = 0; i <= key.size(); ++i) {
+            if (i < key.size() && isWordByte(key[i])) {
+                word.push_back(key[i]);
+            } else if (!word.empty()) {
+                f(std::move(word));
+                word.clear();
+            }
+        }
+    }
+
+private:
+    struct Doc {
+        EntryId id;
+        std::uint32_t length; // In words
+        bool live;
+    };
+
+    struct Postings {
+        std::vector<std::uint8_t> bytes; // (gap, frequency) varint pairs
+        std::uint32_t lastDoc = 0;
+        std::uint32_t count = 0;
+    };
+
+    // Keys are lower case already. Any non-ASCII character counts as a
+    // letter, which keeps multi-byte characters whole.
+    static bool isWordByte(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || static_cast<unsigned char>(c) >= 0x80;
+    }
+
+    static void putVarint(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    static std::uint32_t getVarint(const std::uint8_t*& p) {
+        std::uint32_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            std::uint8_t byte = *p++;
+            value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+    }
+
+    // Renumbers the live documents and rewrites every list without the
+    // dead ones.
+    void compact() {
+        std::vector<std::uint32_t> renumbered(docs.size(), UINT32_MAX);
+        std::vector<Doc> live;
+        live.reserve(docOf.size());
+        totalLength = 0;
+        for (std::size_t number = 0; number < docs.size(); ++number) {
+            if (docs[number].live) {
+                renumbered[number] = static_cast<std::uint32_t>(live.size());
+                docOf[docs[number].id] = renumbered[number];
+                totalLength += docs[number].length;
+                live.push_back(docs[number]);
+            }
+        }
+        for (auto it = postings.begin(); it != postings.end();) {
+            Postings fresh;
+            const std::uint8_t* p = it->second.bytes.data();
+            const std::uint8_t* end = p + it->second.bytes.size();
+            std::uint32_t number = 0;
+            while (p != end) {
+                number += getVarint(p);
+                std::uint32_t tf = getVarint(p);
+                if (renumbered[number] != UINT32_MAX) {
+                    putVarint(fresh.bytes, renumbered[number] - fresh.lastDoc);
+                    putVarint(fresh.bytes, tf);
+                    fresh.lastDoc = renumbered[number];
+                    ++fresh.count;
+                }
+            }
+            if (fresh.count == 0) {
+                it = postings.erase(it);
+            } else {
+                fresh.bytes.shrink_to_fit();
+                it->second = std::move(fresh);
+                ++it;
+            }
+        }
+        docs = std::move(live);
+        deadDocs = 0;
+    }
+
+    std::vector<Doc> docs;
+    std::unordered_map<EntryId, std::uint32_t> docOf; // Live documents only
+    std::unordered_map<std::string, Postings> postings;
+    std::uint64_t totalLength = 0; // In words, dead documents included
+    std::size_t deadDocs = 0;
+    std::unordered_map<std::string, std::uint32_t> counts; // Scratch for add()
+};
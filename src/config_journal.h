@@ -0,0 +1,240 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "config_loader.h"
+#include "durable_file.h"
+
+// Append-only mutation log kept next to config.json.
+//
+// config.json is the snapshot; config.journal holds one JSON record per line
+// ({"seq":N,"op":"add","id":I,...} / {"seq":N,"op":"delete","id":I}).
+// Records refer to entries by their persistent ID. The snapshot carries
+// "journalSeq", the last record folded into it, so replaying the journal on
+// top of any snapshot is idempotent. Once the journal passes
+// compactionThreshold bytes the owner folds it into a new snapshot with
+// compact().
+//
+// Durability: the snapshot is only ever replaced atomically, and the
+// journal is the write-ahead log for everything newer. append() hands the
+// records to the OS so a crash of the app loses nothing; sync() makes them
+// survive power loss and is meant to be called once per group of appends.
+// recover() runs before the first load and discards what an interrupted
+// write can leave behind.
+//
+// Not thread-safe: PersistenceWorker owns the journal and drives it from its
+// own thread. read() only touches the files and may run anywhere.
+class ConfigJournal {
+public:
+    using json = nlohmann::json;
+
+    static constexpr std::uintmax_t compactionThreshold = 256 * 1024;
+
+    // Bookkeeping from a read(), which adopt() needs to continue appending
+    // after it, plus any malformed snapshot items that were skipped.
+    struct ReplayResult {
+        std::uint64_t snapshotSeq = 0;
+        std::uint64_t nextSeq = 1;
+        std::uintmax_t journalBytes = 0;
+        std::vector<ConfigIssue> issues;
+    };
+
+    explicit ConfigJournal(const std::string& configPath)
+        : snapshotPath(configPath),
+          journalPath(std::filesystem::path(configPath).replace_extension(".journal").string()) {}
+
+    ConfigJournal(const ConfigJournal&) = delete;
+    ConfigJournal& operator=(const ConfigJournal&) = delete;
+
+    const std::string& path() const { return snapshotPath; }
+
+    // Removes a leftover snapshot temp file and cuts a torn record off the
+    // end of the journal, so new appends never land behind garbage that
+    // replay would stop at. Returns a description of what was repaired, or
+    // an empty string.
+    std::string recover() {
+        std::string repaired;
+        std::error_code ec;
+        if (std::filesystem::remove(AtomicFile::tempPath(snapshotPath), ec)) {
+            repaired = "discarded an unfinished config.json write";
+        }
+        std::ifstream journalFile(journalPath, std::ios::binary);
+        if (!journalFile.is_open()) {
+            return repaired;
+        }
+        std::uintmax_t validBytes = 0;
+        std::string line;
+        while (std::getline(journalFile, line)) {
+            if (journalFile.eof()) {
+                break; // No trailing newline: the last append was cut short.
+            }
+            json record = json::parse(line, nullptr, false);
+            if (record.is_discarded() || !record.is_object()) {
+                break;
+            }
+            validBytes += line.size() + 1;
+        }
+        journalFile.close();
+        std::uintmax_t size = std::filesystem::file_size(journalPath, ec);
+        if (!ec && size > validBytes) {
+            openLog();
+            log.truncate(validBytes);
+            if (!repaired.empty()) {
+                repaired += "; ";
+            }
+            repaired += "dropped " + std::to_string(size - validBytes) + " bytes of an interrupted journal append";
+        }
+        return repaired;
+    }
+
+    // Streams the snapshot into sink and replays every journal record newer
+    // than it. Sink provides appendItem(name, value, id, tags), called with
+    // std::string temporaries, a std::uint64_t ID (0 for none) and an
+    // rvalue std::vector<std::string>, and removeItemById(std::uint64_t).
+    // Only touches the files, so it may run on any thread. Throws if the
+    // snapshot cannot be opened or is not valid JSON.
+    template <typename Sink>
+    ReplayResult read(Sink& sink) const {
+        ConfigLoadResult snapshot = loadConfigFile(snapshotPath, sink);
+        ReplayResult result = replay(sink, snapshot.journalSeq);
+        result.issues = std::move(snapshot.issues);
+        return result;
+    }
+
+    // Replays the journal records newer than snapshotSeq into a sink that
+    // already holds the snapshot's entries, e.g. from the binary cache.
+    template <typename Sink>
+    ReplayResult replay(Sink& sink, std::uint64_t snapshotSeq) const {
+        ReplayResult result;
+        result.snapshotSeq = snapshotSeq;
+        std::uint64_t lastSeq = snapshotSeq;
+        std::ifstream journalFile(journalPath);
+        std::string line;
+        while (journalFile.is_open() && std::getline(journalFile, line)) {
+            json record = json::parse(line, nullptr, false);
+            if (record.is_discarded() || !record.is_object()) {
+                break; // Torn tail from an interrupted append; nothing after it is trusted.
+            }
+            std::uint64_t seq = record.value("seq", std::uint64_t(0));
+            if (seq <= snapshotSeq) {
+                continue;
+            }
+            apply(sink, record);
+            lastSeq = std::max(lastSeq, seq);
+            result.journalBytes += line.size() + 1;
+        }
+        result.nextSeq = lastSeq + 1;
+        return result;
+    }
+
+    // Takes over the bookkeeping of a read() so appends continue after it.
+    void adopt(const ReplayResult& result) {
+        nextSeq = result.nextSeq;
+        journalBytes = result.journalBytes;
+    }
+
+    template <typename Sink>
+    ReplayResult load(Sink& sink) {
+        ReplayResult result = read(sink);
+        adopt(result);
+        return result;
+    }
+
+    // Sequence number of the last record appended, i.e. what a snapshot
+    // written now would carry as journalSeq.
+    std::uint64_t lastSeq() const { return nextSeq - 1; }
+
+    static json addRecord(std::uint64_t id, const std::string& name, const std::string& value,
+                          const std::vector<std::string>& tags = {}) {
+        json record = {{"op", "add"}, {"id", id}, {"name", name}, {"value", value}};
+        if (!tags.empty()) {
+            record["tags"] = tags;
+        }
+        return record;
+    }
+
+    static json deleteRecord(std::uint64_t id) {
+        return {{"op", "delete"}, {"id", id}};
+    }
+
+    // Appends records in one write, numbering them in order. The records
+    // are durable only after the next sync().
+    void append(std::vector<json>& records) {
+        if (records.empty()) {
+            return;
+        }
+        std::string lines;
+        std::uint64_t seq = nextSeq;
+        for (json& record : records) {
+            record["seq"] = seq++;
+            lines += record.dump();
+            lines += '\n';
+        }
+        openLog();
+        log.append(lines);
+        nextSeq = seq;
+        journalBytes += lines.size();
+    }
+
+    bool needsSync() const { return log.needsSync(); }
+
+    void sync() { log.sync(); }
+
+    bool needsCompaction() const {
+        return journalBytes >= compactionThreshold;
+    }
+
+    // Writes itemsJson, the serialized "items" array, which must reflect
+    // every record appended so far, as the new snapshot and empties the
+    // journal.
+    void compact(const std::string& itemsJson) {
+        std::string snapshot = "{\n  \"items\": " + itemsJson + ",\n  \"journalSeq\": "
+            + std::to_string(nextSeq - 1) + "\n}\n";
+        AtomicFile::write(snapshotPath, snapshot);
+        // Every record is now at or below journalSeq, so a crash before the
+        // truncation below only leaves records that replay skips.
+        openLog();
+        log.truncate(0);
+        journalBytes = 0;
+    }
+
+private:
+    template <typename Sink>
+    static void apply(Sink& sink, const json& record) {
+        std::string op = record.value("op", "");
+        if (op == "add") {
+            std::vector<std::string> tags;
+            auto it = record.find("tags");
+            if (it != record.end() && it->is_array()) {
+                for (const json& tag : *it) {
+                    if (tag.is_string()) {
+                        tags.push_back(tag.get<std::string>());
+                    }
+                }
+            }
+            sink.appendItem(record.value("name", ""), record.value("value", ""), record.value("id", std::uint64_t(0)),
+                            std::move(tags));
+        } else if (op == "delete") {
+            sink.removeItemById(record.value("id", std::uint64_t(0)));
+        }
+    }
+
+    void openLog() {
+        if (!log.isOpen()) {
+            log.open(journalPath);
+        }
+    }
+
+    std::string snapshotPath;
+    std::string journalPath;
+    AppendFile log;
+    std::uint64_t nextSeq = 1;
+    std::uintmax_t journalBytes = 0;
+};
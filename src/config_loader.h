@@ -0,0 +1,369 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A malformed item skipped while loading, with the byte offset of the item
+// (or of the parse error) in config.json.
+struct ConfigIssue {
+    std::size_t offset;
+    std::string message;
+};
+
+// Streams the "items" array of config.json into a sink without building a
+// DOM. Sink provides appendItem(std::string&& name, std::string&& value,
+// std::uint64_t id, std::vector<std::string>&& tags), with id 0 when the
+// item has no positive integer "id" and tags empty when it has no "tags".
+// Top-level keys other than "items" and "journalSeq", and item keys other
+// than "id", "name", "value" and "tags", are stepped over without being
+// stored.
+template <typename Sink>
+class ConfigSaxLoader : public nlohmann::json_sax<nlohmann::json> {
+public:
+    using json = nlohmann::json;
+
+    ConfigSaxLoader(Sink& sink, const char* begin, const char* const* cursor)
+        : sink(sink), begin(begin), cursor(cursor) {}
+
+    std::uint64_t journalSeq = 0;
+    std::vector<ConfigIssue> issues;
+    std::string error; // Set when the document itself is not valid JSON
+
+    bool null() override { return scalar(); }
+    bool boolean(bool) override { return scalar(); }
+    bool number_integer(number_integer_t value) override {
+        if (value >= 0) {
+            number(static_cast<std::uint64_t>(value));
+        }
+        return scalar();
+    }
+    bool number_unsigned(number_unsigned_t value) override {
+        number(value);
+        return scalar();
+    }
+    bool number_float(number_float_t, const string_t&) override { return scalar(); }
+    bool binary(binary_t&) override { return scalar(); }
+
+    bool string(string_t& value) override {
+        if (skipDepth == 0 && state == State::Tags) {
+            itemTags.push_back(std::move(value));
+            return true;
+        }
+        if (skipDepth == 0 && state == State::ItemField) {
+            if (field == Field::Name) {
+                name = std::move(value);
+                hasName = true;
+            } else if (field == Field::Value) {
+                itemValue = std::move(value);
+                hasValue = true;
+            }
+        }
+        return scalar();
+    }
+
+    bool start_object(std::size_t) override {
+        if (skipDepth > 0) {
+            ++skipDepth;
+            return true;
+        }
+        switch (state) {
+        case State::Start:
+            state = State::TopLevel;
+            return true;
+        case State::Items:
+            state = State::Item;
+            itemOffset = offset();
+            itemId = 0;
+            hasName = hasValue = false;
+            itemTags.clear();
+            itemBroken.clear();
+            return true;
+        case State::ItemField:
+            noteBroken(fieldProblem());
+            state = State::Item;
+            ++skipDepth;
+            return true;
+        case State::Tags:
+            noteBroken(fieldProblem());
+            ++skipDepth;
+            return true;
+        default:
+            return skipValue();
+        }
+    }
+
+    bool key(string_t& value) override {
+        if (skipDepth > 0) {
+            return true;
+        }
+        if (state == State::TopLevel) {
+            if (value == "items") {
+                state = State::ItemsKey;
+            } else if (value == "journalSeq") {
+                state = State::JournalSeq;
+            } else {
+                state = State::TopLevelValue;
+            }
+        } else if (state == State::Item) {
+            field = value == "name" ? Field::Name
+                : value == "value" ? Field::Value
+                : value == "id" ? Field::Id
+                : value == "tags" ? Field::Tags
+                : Field::Other;
+            state = State::ItemField;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        if (skipDepth > 0) {
+            --skipDepth;
+            return true;
+        }
+        if (state == State::Item) {
+            finishItem();
+            state = State::Items;
+        } else if (state == State::TopLevel) {
+            state = State::Done;
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (skipDepth > 0) {
+            ++skipDepth;
+            return true;
+        }
+        if (state == State::ItemsKey) {
+            state = State::Items;
+            return true;
+        }
+        if (state == State::ItemField && field == Field::Tags) {
+            state = State::Tags;
+            return true;
+        }
+        if (state == State::Items) {
+            issues.push_back({offset(), "item is not an object"});
+        } else if (state == State::ItemField) {
+            noteBroken(fieldProblem());
+            state = State::Item;
+        } else if (state == State::Tags) {
+            noteBroken(fieldProblem());
+        } else if (state == State::Start) {
+            state = State::Done;
+        } else {
+            advanceAfterValue();
+        }
+        ++skipDepth;
+        return true;
+    }
+
+    bool end_array() override {
+        if (skipDepth > 0) {
+            --skipDepth;
+            return true;
+        }
+        if (state == State::Items) {
+            state = State::TopLevel;
+        } else if (state == State::Tags) {
+            state = State::Item;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        error = std::string(ex.what()) + " (byte " + std::to_string(position) + ")";
+        if (state == State::Item) {
+            issues.push_back({itemOffset, "item is cut off by a syntax error"});
+        }
+        issues.push_back({position, ex.what()});
+        return false;
+    }
+
+private:
+    enum class State { Start, TopLevel, TopLevelValue, ItemsKey, JournalSeq, Items, Item, ItemField, Tags, Done };
+    enum class Field { Name, Value, Id, Tags, Other };
+
+    std::size_t offset() const {
+        // The lexer has consumed the current token; point at its first byte
+        // for single-character tokens and close to it otherwise.
+        std::size_t consumed = static_cast<std::size_t>(*cursor - begin);
+        return consumed > 0 ? consumed - 1 : 0;
+    }
+
+    bool scalar() {
+        if (skipDepth > 0) {
+            return true;
+        }
+        switch (state) {
+        case State::Items:
+            issues.push_back({offset(), "item is not an object"});
+            break;
+        case State::ItemField:
+            if ((isTextField() && !((field == Field::Name && hasName) || (field == Field::Value && hasValue)))
+                || field == Field::Tags) {
+                noteBroken(fieldProblem());
+            }
+            state = State::Item;
+            break;
+        case State::Tags:
+            noteBroken(fieldProblem());
+            break;
+        case State::Start:
+            state = State::Done;
+            break;
+        default:
+            advanceAfterValue();
+            break;
+        }
+        return true;
+    }
+
+    void number(std::uint64_t value) {
+        if (skipDepth > 0) {
+            return;
+        }
+        if (state == State::JournalSeq) {
+            journalSeq = value;
+        } else if (state == State::ItemField && field == Field::Id) {
+            itemId = value;
+        }
+    }
+
+    bool skipValue() {
+        advanceAfterValue();
+        ++skipDepth;
+        return true;
+    }
+
+    // A top-level value that is not "items" has been entered or read.
+    void advanceAfterValue() {
+        if (state == State::TopLevelValue || state == State::ItemsKey || state == State::JournalSeq) {
+            state = State::TopLevel;
+        }
+    }
+
+    bool isTextField() const { return field == Field::Name || field == Field::Value; }
+
+    // Why the current field's value makes the item malformed, or empty if
+    // the field is not one we read.
+    std::string fieldProblem() const {
+        switch (field) {
+        case Field::Name: return "\"name\" is not a string";
+        case Field::Value: return "\"value\" is not a string";
+        case Field::Tags: return "\"tags\" is not an array of strings";
+        default: return std::string();
+        }
+    }
+
+    void noteBroken(const std::string& reason) {
+        if (!reason.empty() && itemBroken.empty()) {
+            itemBroken = reason;
+        }
+    }
+
+    void finishItem() {
+        if (!itemBroken.empty()) {
+            issues.push_back({itemOffset, itemBroken});
+        } else if (!hasName || !hasValue) {
+            issues.push_back({itemOffset, hasName ? "missing \"value\"" : "missing \"name\""});
+        } else {
+            sink.appendItem(std::move(name), std::move(itemValue), itemId, std::move(itemTags));
+        }
+        name.clear();
+        itemValue.clear();
+        itemTags.clear();
+    }
+
+    Sink& sink;
+    const char* begin;
+    const char* const* cursor;
+    State state = State::Start;
+    Field field = Field::Other;
+    int skipDepth = 0;
+    std::size_t itemOffset = 0;
+    std::uint64_t itemId = 0;
+    std::string name;
+    std::string itemValue;
+    std::vector<std::string> itemTags;
+    bool hasName = false;
+    bool hasValue = false;
+    std::string itemBroken;
+};
+
+// Forward iterator over a byte buffer that publishes how far the parser has
+// read, which is what lets the SAX handler attach offsets to its issues.
+class CountingCharIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char*;
+    using reference = const char&;
+
+    CountingCharIterator() = default;
+    CountingCharIterator(const char* position, const char** cursor) : position(position), cursor(cursor) {}
+
+    reference operator*() const { return *position; }
+    CountingCharIterator& operator++() {
+        ++position;
+        if (cursor) {
+            *cursor = position;
+        }
+        return *this;
+    }
+    CountingCharIterator operator++(int) {
+        CountingCharIterator previous = *this;
+        ++*this;
+        return previous;
+    }
+    bool operator==(const CountingCharIterator& other) const { return position == other.position; }
+    bool operator!=(const CountingCharIterator& other) const { return position != other.position; }
+
+private:
+    const char* position = nullptr;
+    const char** cursor = nullptr;
+};
+
+struct ConfigLoadResult {
+    std::uint64_t journalSeq = 0;
+    std::vector<ConfigIssue> issues;
+};
+
+// Streams a config document held in memory into sink. Throws with the
+// byte offset if the document is not valid JSON.
+template <typename Sink>
+ConfigLoadResult loadConfigBuffer(const char* data, std::size_t size, Sink& sink) {
+    const char* cursor = data;
+    ConfigSaxLoader<Sink> loader(sink, data, &cursor);
+    nlohmann::json::sax_parse(CountingCharIterator(data, &cursor), CountingCharIterator(data + size, nullptr), &loader);
+    if (!loader.error.empty()) {
+        throw std::runtime_error(loader.error);
+    }
+    return {loader.journalSeq, std::move(loader.issues)};
+}
+
+template <typename Sink>
+ConfigLoadResult loadConfigFile(const std::string& path, Sink& sink) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    std::string buffer;
+    file.seekg(0, std::ios::end);
+    std::streamoff size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    if (size > 0) {
+        buffer.resize(static_cast<std::size_t>(size));
+        file.read(&buffer[0], size);
+        buffer.resize(static_cast<std::size_t>(file.gcount()));
+    }
+    return loadConfigBuffer(buffer.data(), buffer.size(), sink);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QTimer>
+
+// Watches config.json and its directory and emits changed() once a burst of
+// filesystem events has settled. Editors that save by writing a temp file
+// and renaming it over the original drop the file watch, so the directory
+// is watched too and the file watch is re-armed whenever it reappears.
+// Writes made by the app itself are registered with noteSelfWrite() and do
+// not trigger changed().
+class ConfigWatcher : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int debounceMs = 200;
+
+    ConfigWatcher(const QString& configPath, QObject* parent = nullptr)
+        : QObject(parent), configPath(QFileInfo(configPath).absoluteFilePath()) {
+        watcher = new QFileSystemWatcher(this);
+        watcher->addPath(QFileInfo(this->configPath).absolutePath());
+        rearm();
+        debounce = new QTimer(this);
+        debounce->setSingleShot(true);
+        debounce->setInterval(debounceMs);
+        connect(watcher, &QFileSystemWatcher::fileChanged, this, &ConfigWatcher::onPathChanged);
+        connect(watcher, &QFileSystemWatcher::directoryChanged, this, &ConfigWatcher::onPathChanged);
+        connect(debounce, &QTimer::timeout, this, &ConfigWatcher::settle);
+        known = signature();
+    }
+
+    // Records the file as it is now, e.g. right after the app replaced it,
+    // so the events caused by that write are not reported as a change.
+    void noteSelfWrite() {
+        known = signature();
+    }
+
+signals:
+    void changed();
+
+private slots:
+    void onPathChanged() {
+        rearm();
+        debounce->start();
+    }
+
+    void settle() {
+        rearm();
+        Signature current = signature();
+        if (current == known) {
+            return;
+        }
+        known = current;
+        emit changed();
+    }
+
+private:
+    struct Signature {
+        bool exists = false;
+        qint64 size = 0;
+        qint64 mtimeMs = 0;
+        bool operator==(const Signature& other) const {
+            return exists == other.exists && size == other.size && mtimeMs == other.mtimeMs;
+        }
+    };
+
+    Signature signature() const {
+        QFileInfo info(configPath);
+        Signature sig;
+        sig.exists = info.exists();
+        if (sig.exists) {
+            sig.size = info.size();
+            sig.mtimeMs = info.lastModified().toMSecsSinceEpoch();
+        }
+        return sig;
+    }
+
+    void rearm() {
+        if (!watcher->files().contains(configPath) && QFileInfo::exists(configPath)) {
+            watcher->addPath(configPath);
+        }
+    }
+
+    QString configPath;
+    QFileSystemWatcher* watcher;
+    QTimer* debounce;
+    Signature known;
+};
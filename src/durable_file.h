@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Low-level file helpers for the config files. Everything here throws
+// std::runtime_error with the path and errno text on failure.
+
+// Replaces a file so that readers and crashes only ever see the old or the
+// new contents: write a sibling temp file, flush it to stable storage,
+// rename it over the target, then flush the directory entry.
+class AtomicFile {
+public:
+    static std::string tempPath(const std::string& path) { return path + ".tmp"; }
+
+    static void write(const std::string& path, const std::string& data) {
+        std::string tmp = tempPath(path);
+        int fd = openFile(tmp, O_WRONLY | O_CREAT | O_TRUNC);
+        try {
+            writeAll(fd, data, tmp);
+            syncFd(fd, tmp);
+        } catch (...) {
+            closeFd(fd);
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            throw;
+        }
+        closeFd(fd);
+        replace(tmp, path);
+        syncDirectoryOf(path);
+    }
+
+    static int openFile(const std::string& path, int flags) {
+#ifdef _WIN32
+        int fd = _open(path.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        int fd = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+#endif
+        if (fd < 0) {
+            fail("Could not open", path);
+        }
+        return fd;
+    }
+
+    static void writeAll(int fd, const std::string& data, const std::string& path) {
+        const char* p = data.data();
+        std::size_t left = data.size();
+        while (left > 0) {
+#ifdef _WIN32
+            int n = _write(fd, p, static_cast<unsigned int>(left));
+#else
+            ssize_t n = ::write(fd, p, left);
+#endif
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                fail("Could not write", path);
+            }
+            p += n;
+            left -= static_cast<std::size_t>(n);
+        }
+    }
+
+    static void syncFd(int fd, const std::string& path) {
+#if defined(_WIN32)
+        int rc = _commit(fd);
+#elif defined(__APPLE__)
+        // fsync() on macOS does not flush the drive cache.
+        int rc = fcntl(fd, F_FULLFSYNC);
+        if (rc != 0) {
+            rc = ::fsync(fd);
+        }
+#else
+        int rc = ::fsync(fd);
+#endif
+        if (rc != 0) {
+            fail("Could not sync", path);
+        }
+    }
+
+    static void closeFd(int fd) {
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+
+    // Makes a completed rename or truncation durable. Windows has no
+    // directory handles to flush; MoveFileEx with WRITE_THROUGH covers it.
+    static void syncDirectoryOf(const std::string& path) {
+#ifndef _WIN32
+        std::filesystem::path dir = std::filesystem::path(path).parent_path();
+        if (dir.empty()) {
+            dir = ".";
+        }
+        int fd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        ::fsync(fd);
+        ::close(fd);
+#else
+        (void)path;
+#endif
+    }
+
+    [[noreturn]] static void fail(const char* what, const std::string& path) {
+        throw std::runtime_error(std::string(what) + " " + path + ": " + std::strerror(errno));
+    }
+
+private:
+    static void replace(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+        std::wstring wfrom = std::filesystem::path(from).wstring();
+        std::wstring wto = std::filesystem::path(to).wstring();
+        if (!MoveFileExW(wfrom.c_str(), wto.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            throw std::runtime_error("Could not replace " + to);
+        }
+#else
+        if (::rename(from.c_str(), to.c_str()) != 0) {
+            fail("Could not replace", to);
+        }
+#endif
+    }
+};
+
+// Append-only file kept open between writes. append() only hands the bytes
+// to the OS; sync() makes everything appended so far durable, so callers
+// can group several appends under one flush.
+class AppendFile {
+public:
+    AppendFile() = default;
+    ~AppendFile() { close(); }
+
+    AppendFile(const AppendFile&) = delete;
+    AppendFile& operator=(const AppendFile&) = delete;
+
+    void open(const std::string& filePath) {
+        close();
+        path = filePath;
+        fd = AtomicFile::openFile(path, O_WRONLY | O_CREAT | O_APPEND);
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    void append(const std::string& data) {
+        AtomicFile::writeAll(fd, data, path);
+        dirty = true;
+    }
+
+    bool needsSync() const { return dirty; }
+
+    void sync() {
+        if (!dirty || fd < 0) {
+            return;
+        }
+        AtomicFile::syncFd(fd, path);
+        dirty = false;
+    }
+
+    // Cuts the file back to size bytes and makes that durable.
+    void truncate(std::uintmax_t size) {
+        std::filesystem::resize_file(path, size);
+        dirty = true;
+        sync();
+    }
+
+    void close() {
+        if (fd >= 0) {
+            AtomicFile::closeFd(fd);
+            fd = -1;
+        }
+    }
+
+private:
+    std::string path;
+    int fd = -1;
+    bool dirty = false;
+};
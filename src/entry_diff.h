@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "entry_store.h"
+
+// One row operation turning an old entry list into a new one. Edits are
+// ordered bottom-up: row always refers to a position in the old list, so
+// applying them in sequence never shifts a row a later edit still needs.
+struct EntryEdit {
+    enum Kind { Remove, Insert, Change };
+    Kind kind;
+    int row;       // First affected row in the old list (Insert: insert before it)
+    int source;    // First row in the new list (Insert/Change)
+    int count;
+};
+
+struct EntryDiff {
+    std::vector<EntryEdit> edits;
+    bool reset = false; // Too many changes; rebuilding the model is cheaper
+};
+
+// Myers O((N+M)D) diff between two entry lists, where D is the number of
+// inserted plus removed rows. The common prefix and suffix are trimmed with
+// plain comparisons first, so an edit near either end touches only the
+// rows around it. Adjacent remove/insert pairs of equal length are folded
+// into Change edits so the view can update those rows in place.
+inline EntryDiff diffEntries(const EntryStore& before, const EntryStore& after, int maxEdits = 1024) {
+    EntryDiff diff;
+    auto same = [&](int a, int b) {
+        return before.idAt(a) == after.idAt(b) && before.name(a) == after.name(b) && before.value(a) == after.value(b)
+            && before.tagText(a) == after.tagText(b);
+    };
+
+    int oldEnd = before.size();
+    int newEnd = after.size();
+    int start = 0;
+    while (start < oldEnd && start < newEnd && same(start, start)) {
+        ++start;
+    }
+    while (oldEnd > start && newEnd > start && same(oldEnd - 1, newEnd - 1)) {
+        --oldEnd;
+        --newEnd;
+    }
+    const int n = oldEnd - start;
+    const int m = newEnd - start;
+    if (n == 0 && m == 0) {
+        return diff;
+    }
+
+    const int limit = std::min(n + m, maxEdits);
+    const int offset = limit + 1;
+    std::vector<int> v(2 * static_cast<std::size_t>(limit) + 3, 0);
+    // trace[d] holds v[-d..d] as it stood before round d, which is all the
+    // backtrack needs; keeping only that window bounds memory by O(D^2).
+    std::vector<std::vector<int>> trace;
+    bool found = false;
+    for (int d = 0; d <= limit && !found; ++d) {
+        trace.emplace_back(v.begin() + (offset - d), v.begin() + (offset + d + 1));
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+                ? v[offset + k + 1]
+                : v[offset + k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && same(start + x, start + y)) {
+                ++x;
+                ++y;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                found = true;
+                break;
+            }
+        }
+    }
+    if (!found) {
+        diff.reset = true;
+        return diff;
+    }
+
+    // Walk the trace backwards, emitting edits bottom-up and merging runs as
+    // we go. Diagonal snakes between moves are unchanged rows.
+    std::vector<EntryEdit>& edits = diff.edits;
+    int x = n;
+    int y = m;
+    for (int d = static_cast<int>(trace.size()) - 1; d > 0; --d) {
+        const std::vector<int>& prev = trace[d];
+        auto at = [&prev, d](int k) { return prev[k + d]; };
+        int k = x - y;
+        bool down = k == -d || (k != d && at(k - 1) < at(k + 1));
+        int prevK = down ? k + 1 : k - 1;
+        int prevX = at(prevK);
+        int prevY = prevX - prevK;
+        int row = start + prevX;
+        if (down) {
+            // b[prevY] is inserted before old row prevX.
+            int source = start + prevY;
+            if (!edits.empty() && edits.back().kind == EntryEdit::Insert && edits.back().row == row
+                && edits.back().source == source + 1) {
+                edits.back().source = source;
+                ++edits.back().count;
+            } else {
+                edits.push_back({EntryEdit::Insert, row, source, 1});
+            }
+        } else {
+            // a[prevX] is removed.
+            if (!edits.empty() && edits.back().kind == EntryEdit::Remove && edits.back().row == row + 1) {
+                edits.back().row = row;
+                ++edits.back().count;
+            } else {
+                edits.push_back({EntryEdit::Remove, row, 0, 1});
+            }
+        }
+        x = prevX;
+        y = prevY;
+    }
+
+    // Insert-after-remove of the same span is a replacement.
+    std::vector<EntryEdit> folded;
+    folded.reserve(edits.size());
+    for (std::size_t i = 0; i < edits.size(); ++i) {
+        const EntryEdit& edit = edits[i];
+        if (i + 1 < edits.size() && edit.kind == EntryEdit::Insert) {
+            const EntryEdit& next = edits[i + 1];
+            if (next.kind == EntryEdit::Remove && next.count == edit.count && next.row + next.count == edit.row) {
+                folded.push_back({EntryEdit::Change, next.row, edit.source, edit.count});
+                ++i;
+                continue;
+            }
+        }
+        folded.push_back(edit);
+    }
+    edits.swap(folded);
+    return diff;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include "entry_diff.h"
+#include "entry_store.h"
+
+// List model over an EntryStore. Nothing per row is materialized up front:
+// the elided preview, display text and tooltip are built in data(), which
+// the view only calls for rows it is about to paint.
+class EntryListModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    static constexpr int ValueRole = Qt::UserRole;
+    static constexpr int NameRole = Qt::UserRole + 1;
+    static constexpr int IdRole = Qt::UserRole + 2;
+    static constexpr int TagsRole = Qt::UserRole + 3;
+
+    explicit EntryListModel(QObject* parent = nullptr) : QAbstractListModel(parent) {}
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : entries.size();
+    }
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override {
+        if (!index.isValid() || index.row() < 0 || index.row() >= entries.size()) {
+            return QVariant();
+        }
+        const int row = index.row();
+        switch (role) {
+        case Qt::DisplayRole: {
+            QString displayValue = preview(entries.value(row));
+            return showKeys ? QString("%1 > %2").arg(entries.name(row).toString(), displayValue) : displayValue;
+        }
+        case Qt::ToolTipRole:
+        case ValueRole:
+            return entries.value(row).toString();
+        case NameRole:
+            return entries.name(row).toString();
+        case IdRole:
+            return QVariant::fromValue<qulonglong>(entries.idAt(row));
+        case TagsRole:
+            return entries.tags(row);
+        default:
+            return QVariant();
+        }
+    }
+
+    Qt::ItemFlags flags(const QModelIndex& index) const override {
+        Qt::ItemFlags base = QAbstractListModel::flags(index);
+        return index.isValid() ? base | Qt::ItemIsDragEnabled : base;
+    }
+
+    const EntryStore& store() const { return entries; }
+
+    // Changes whenever the entries do, before the model signals the change.
+    std::uint64_t revision() const { return revisionCount; }
+
+    void setEntries(EntryStore store) {
+        beginResetModel();
+        entries = std::move(store);
+        ++revisionCount;
+        endResetModel();
+    }
+
+    // Brings the model in line with next using only the row operations in
+    // diff, so selection, scroll position and untouched rows survive.
+    void applyDiff(const EntryStore& next, const EntryDiff& diff) {
+        if (diff.reset) {
+            setEntries(next);
+            return;
+        }
+        for (const EntryEdit& edit : diff.edits) {
+            switch (edit.kind) {
+            case EntryEdit::Remove:
+                beginRemoveRows(QModelIndex(), edit.row, edit.row + edit.count - 1);
+                entries.remove(edit.row, edit.count);
+                ++revisionCount;
+                endRemoveRows();
+                break;
+            case EntryEdit::Insert:
+                beginInsertRows(QModelIndex(), edit.row, edit.row + edit.count - 1);
+                entries.insert(edit.row, next, edit.source, edit.count);
+                ++revisionCount;
+                endInsertRows();
+                break;
+            case EntryEdit::Change:
+                for (int i = 0; i < edit.count; ++i) {
+                    entries.replace(edit.row + i, next, edit.source + i);
+                }
+                ++revisionCount;
+                emit dataChanged(index(edit.row), index(edit.row + edit.count - 1));
+                break;
+            }
+        }
+    }
+
+    EntryStore::EntryId appendEntry(const QString& name, const QString& value, const QStringList& tags = QStringList()) {
+        int row = entries.size();
+        beginInsertRows(QModelIndex(), row, row);
+        EntryStore::EntryId id = entries.append(name, value, tags);
+        ++revisionCount;
+        endInsertRows();
+        return id;
+    }
+
+    void removeEntry(int row) {
+        if (row < 0 || row >= entries.size()) {
+            return;
+        }
+        beginRemoveRows(QModelIndex(), row, row);
+        entries.remove(row);
+        ++revisionCount;
+        endRemoveRows();
+    }
+
+    // Switches between "name > preview" and preview-only display text.
+    void setShowKeys(bool show) {
+        if (showKeys == show) {
+            return;
+        }
+        showKeys = show;
+        if (!entries.isEmpty()) {
+            emit dataChanged(index(0), index(entries.size() - 1), {Qt::DisplayRole});
+        }
+    }
+
+    // Elides long values to their start, middle and end. Only the kept
+    // characters are copied out of the store.
+    static QString preview(EntryText value) {
+        if (value.length <= 18) {
+            return value.toString();
+        }
+        int len = value.length;
+        int midStart = len / 2 - 3;
+        return value.mid(0, 6).toString() + ".." + value.mid(midStart, 6).toString() + ".."
+            + value.mid(len - 6, 6).toString();
+    }
+
+private:
+    EntryStore entries;
+    std::uint64_t revisionCount = 0;
+    bool showKeys = true;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMimeData>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <utility>
+#include "entry_store.h"
+
+// An entry's value offered on the clipboard or in a drag, turned into text
+// only when a paste or drop asks for it. Until then it is a reference into
+// the value's block in the EntryStore, so offering a multi-megabyte note
+// costs nothing up front, and the clipboard and a drag of the same value
+// share the store's one copy.
+//
+// Large values reach other X11 clients through Qt's selection handling,
+// which already sends them in INCR chunks.
+class EntryMimeData : public QMimeData {
+public:
+    explicit EntryMimeData(SharedEntryText value) : value(std::move(value)) {}
+
+    bool hasFormat(const QString& mimeType) const override { return mimeType == textFormat(); }
+
+    QStringList formats() const override { return QStringList(textFormat()); }
+
+protected:
+    QVariant retrieveData(const QString& mimeType, QVariant::Type type) const override {
+        if (mimeType != textFormat()) {
+            return QVariant();
+        }
+        EntryText text = value.view();
+        // Encoded straight from the store; a QString result is a copy,
+        // since the requester may keep it after this object is gone.
+        QString raw = QString::fromRawData(reinterpret_cast<const QChar*>(text.data), text.length);
+        if (type == QVariant::ByteArray) {
+            return raw.toUtf8();
+        }
+        return QString(raw.constData(), raw.size());
+    }
+
+private:
+    static QString textFormat() { return QStringLiteral("text/plain"); }
+
+    SharedEntryText value;
+};
@@ -0,0 +1,730 @@
+#pragma once
+
+#include <QAbstractProxyModel>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+#include "bm25_index.h"
+#include "entry_list_model.h"
+#include "filter_plan.h"
+#include "fuzzy_matcher.h"
+#include "name_index.h"
+#include "query_cache.h"
+#include "search_key.h"
+#include "search_pool.h"
+#include "tag_index.h"
+#include "trigram_index.h"
+#include "usage_index.h"
+
+// Filters an EntryListModel by the text in the search field.
+//
+// The trigram index is built when the source is reset and updated as rows
+// are inserted, removed or changed, so a keystroke only queries the index
+// and swaps the list of matching source rows; no row is copied or rebuilt.
+// Refining or shortening a query reuses earlier match sets (QueryCache),
+// so a keystroke costs in proportion to the previous result.
+// With an empty query the model passes every source change straight
+// through, so selection and scroll position behave as without a filter.
+//
+// In fuzzy mode the query is matched as a subsequence (FuzzyMatcher), and
+// in full-text mode its words are looked up in a Bm25Index over values;
+// both list the best rankedResultLimit matches by score instead of in
+// source order.
+//
+// A query in the filter language ("tag:work name:addr* -tag:old", see
+// FilterPlan) is compiled once per distinct text and run against the same
+// indexes, whatever the mode, listing its matches in source order.
+//
+// Entries used often and lately (UsageIndex) get a bonus in the ranked
+// modes, and the "most used" sort lists the used entries among the rows
+// first, best first, and the rest in source order.
+//
+// A tag filter narrows whatever the query shows, or filters on its own
+// with an empty query, to the entries the TagIndex selects for it. Match
+// sets are cached without it, so changing tags never searches again.
+//
+// A query that has to scan the whole index of a large library is split
+// into chunks of about scanChunkBytes of keys and run on a SearchPool,
+// each chunk keeping its own top matches; the chunks are merged on the UI
+// thread. Keystrokes do not wait for such a scan: the previous result stays
+// up until it is done, and a newer query cancels it between chunks and
+// drops its result. Index updates wait for running chunks to finish.
+class EntrySearchModel : public QAbstractProxyModel {
+    Q_OBJECT
+public:
+    static constexpr std::size_t rankedResultLimit = 500;
+    static constexpr std::size_t parallelThreshold = 32 * 1024; // Entries
+    static constexpr std::size_t scanChunkBytes = 128 * 1024;   // Of search keys
+    // Score bonus per doubling of an entry's usage score.
+    static constexpr double fuzzyUsageBoost = FuzzyMatcher::scoreMatch / 2;
+    static constexpr double fullTextUsageBoost = 0.25;
+
+    explicit EntrySearchModel(EntryListModel* entries, QObject* parent = nullptr)
+        : QAbstractProxyModel(parent), entries(entries) {
+        QAbstractProxyModel::setSourceModel(entries);
+        connect(entries, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { beginResetModel(); });
+        connect(entries, &QAbstractItemModel::modelReset, this, [this]() {
+            stopScans();
+            cache.clear();
+            rebuildIndex();
+            refilter();
+            endResetModel();
+        });
+        connect(entries, &QAbstractItemModel::rowsAboutToBeInserted, this,
+                [this](const QModelIndex&, int first, int last) {
+            if (isFiltered()) {
+                beginResetModel();
+            } else {
+                beginInsertRows(QModelIndex(), first, last);
+            }
+        });
+        connect(entries, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+            stopScans();
+            cache.clear();
+            indexRows(first, last);
+            if (isFiltered()) {
+                refilter();
+                endResetModel();
+            } else {
+                endInsertRows();
+                resumeSearch();
+            }
+        });
+        connect(entries, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+                [this](const QModelIndex&, int first, int last) {
+            stopScans();
+            cache.clear();
+            const EntryStore& store = this->entries->store();
+            for (int row = first; row <= last; ++row) {
+                trigrams.remove(store.idAt(row));
+                fullText.remove(store.idAt(row));
+                tags.remove(store.idAt(row));
+            }
+            tagged.reset();
+            if (isFiltered()) {
+                beginResetModel();
+            } else {
+                beginRemoveRows(QModelIndex(), first, last);
+            }
+        });
+        connect(entries, &QAbstractItemModel::rowsRemoved, this, [this]() {
+            if (isFiltered()) {
+                refilter();
+                endResetModel();
+            } else {
+                endRemoveRows();
+                resumeSearch();
+            }
+        });
+        connect(entries, &QAbstractItemModel::dataChanged, this,
+                [this](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles) {
+            if (!roles.isEmpty() && !roles.contains(EntryListModel::ValueRole) && !roles.contains(EntryListModel::NameRole)
+                && !roles.contains(EntryListModel::TagsRole)) {
+                forwardDataChanged(topLeft.row(), bottomRight.row(), roles);
+                return;
+            }
+            stopScans();
+            cache.clear();
+            indexRows(topLeft.row(), bottomRight.row());
+            if (isFiltered()) {
+                beginResetModel();
+                refilter();
+                endResetModel();
+            } else {
+                forwardDataChanged(topLeft.row(), bottomRight.row(), roles);
+                resumeSearch();
+            }
+        });
+        rebuildIndex();
+    }
+
+    ~EntrySearchModel() override { stopScans(); }
+
+    const QString& query() const { return currentQuery; }
+
+    void setQuery(const QString& query) {
+        if (query == currentQuery) {
+            return;
+        }
+        currentQuery = query;
+        currentPlan = FilterPlan::isFilter(query) ? plans.plan(query) : nullptr;
+        search();
+    }
+
+    // Lets filter queries look name prefixes up in names' automaton
+    // whenever it is up to date.
+    void setNameIndex(const NameIndex* index) { names = index; }
+
+    // Usage for used: clauses, ranking and the most-used sort. The model
+    // does not watch it: the order follows new uses the next time the rows
+    // are filtered, or on applyUsage(), so rows never move under the
+    // pointer while it is clicking or dragging them.
+    void setUsage(const UsageIndex* index) {
+        usage = index;
+        usesOf = nullptr;
+        if (index) {
+            usesOf = [index](EntryStore::EntryId id) { return index->uses(id); };
+        }
+    }
+
+    bool isSortedByUsage() const { return sortByUsage; }
+
+    void setSortByUsage(bool sort) {
+        if (sortByUsage == sort) {
+            return;
+        }
+        sortByUsage = sort;
+        search();
+    }
+
+    void applyUsage() { search(); }
+
+    const QString& tagFilter() const { return currentTagFilter; }
+
+    // Shows only entries carrying every tag in filter and none of those
+    // written with a leading '-', e.g. "work email -old". Tags are
+    // separated by spaces or commas and compared like queries.
+    void setTagFilter(const QString& filter) {
+        if (filter == currentTagFilter) {
+            return;
+        }
+        currentTagFilter = filter;
+        includeTags.clear();
+        excludeTags.clear();
+        QString tag;
+        for (int i = 0; i <= filter.size(); ++i) {
+            if (i < filter.size() && !filter[i].isSpace() && filter[i] != QLatin1Char(',')) {
+                tag += filter[i];
+                continue;
+            }
+            bool exclude = tag.startsWith(QLatin1Char('-'));
+            std::string key = SearchKey::fold(exclude ? tag.mid(1) : tag);
+            if (!key.empty()) {
+                (exclude ? excludeTags : includeTags).push_back(std::move(key));
+            }
+            tag.clear();
+        }
+        tagged.reset();
+        search();
+    }
+
+    // Whether the rows shown are a match set; lags query() while a deferred
+    // scan runs.
+    bool isFiltered() const { return filtered; }
+
+    enum class Mode { Substring, Fuzzy, FullText };
+
+    Mode mode() const { return searchMode; }
+
+    void setMode(Mode mode) {
+        if (searchMode == mode) {
+            return;
+        }
+        searchMode = mode;
+        search();
+    }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override {
+        if (parent.isValid()) {
+            return 0;
+        }
+        return isFiltered() ? static_cast<int>(rows.size()) : entries->rowCount();
+    }
+
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : 1; }
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override {
+        if (parent.isValid() || column != 0 || row < 0 || row >= rowCount()) {
+            return QModelIndex();
+        }
+        return createIndex(row, column);
+    }
+
+    QModelIndex parent(const QModelIndex&) const override { return QModelIndex(); }
+
+    QModelIndex mapToSource(const QModelIndex& proxyIndex) const override {
+        if (!proxyIndex.isValid()) {
+            return QModelIndex();
+        }
+        return entries->index(isFiltered() ? rows[static_cast<std::size_t>(proxyIndex.row())] : proxyIndex.row());
+    }
+
+    QModelIndex mapFromSource(const QModelIndex& sourceIndex) const override {
+        if (!sourceIndex.isValid()) {
+            return QModelIndex();
+        }
+        if (!isFiltered()) {
+            return index(sourceIndex.row(), 0);
+        }
+        auto rank = rankOf.find(sourceIndex.row());
+        if (rank != rankOf.end()) {
+            return index(rank->second, 0);
+        }
+        auto it = std::lower_bound(rows.begin() + static_cast<std::ptrdiff_t>(sortedFrom), rows.end(), sourceIndex.row());
+        if (it == rows.end() || *it != sourceIndex.row()) {
+            return QModelIndex();
+        }
+        return index(static_cast<int>(it - rows.begin()), 0);
+    }
+
+private:
+    bool isFuzzy() const { return searchMode == Mode::Fuzzy; }
+
+    void rebuildIndex() {
+        trigrams.clear();
+        fullText.clear();
+        tags.clear();
+        indexRows(0, entries->rowCount() - 1);
+    }
+
+    void indexRows(int first, int last) {
+        const EntryStore& store = entries->store();
+        for (int row = first; row <= last; ++row) {
+            std::string valueKey = SearchKey::fold(store.value(row));
+            trigrams.add(store.idAt(row), SearchKey::fold(store.name(row)), valueKey);
+            fullText.add(store.idAt(row), valueKey);
+            tags.add(store.idAt(row), TagIndex::keysOf(store, row));
+        }
+        tagged.reset();
+    }
+
+    bool hasTagFilter() const { return !includeTags.empty() || !excludeTags.empty(); }
+
+    // Entries passing the tag filter, or null without one. Selected again
+    // only after the filter or the index changed.
+    std::shared_ptr<const RoaringBitmap> taggedEntries() {
+        if (hasTagFilter() && !tagged) {
+            tagged = std::make_shared<const RoaringBitmap>(tags.select(includeTags, excludeTags));
+        }
+        return tagged;
+    }
+
+    // Fuzzy score bonus by entry, for the used entries only.
+    using UsageBoosts = std::unordered_map<EntryStore::EntryId, int>;
+
+    // A whole-index scan split over the pool: the chunk ranges and one
+    // result slot per chunk, filled by whichever worker runs it.
+    struct Scan {
+        std::string needle;
+        bool fuzzy = false;
+        bool deferred = false; // Applied by finishScan() rather than waited for
+        std::shared_ptr<const RoaringBitmap> allowed; // Tag filter for the ranking, if any
+        UsageBoosts boosts; // Taken on the UI thread, which alone touches the UsageIndex
+        std::vector<std::pair<std::size_t, std::size_t>> chunks;
+        std::vector<std::vector<EntryStore::EntryId>> matched;
+        std::vector<std::vector<std::pair<int, EntryStore::EntryId>>> best;
+        std::atomic<bool> cancelled{false};
+        std::atomic<std::size_t> remaining{0};
+    };
+
+    // Applies the current query. A query that needs a whole-index scan of a
+    // large library runs deferred; anything else is applied at once.
+    void search() {
+        cancelScan();
+        if (!currentQuery.isEmpty() && !currentPlan) {
+            std::string needle = SearchKey::fold(currentQuery);
+            if (!cache.find(isFuzzy(), needle) && !cache.narrowest(isFuzzy(), needle) && isParallelScan(needle)) {
+                pending = startScan(needle, true);
+                return;
+            }
+        }
+        beginResetModel();
+        refilter();
+        endResetModel();
+    }
+
+    // Queries the posting lists cannot answer, on enough entries to be
+    // worth splitting.
+    bool isParallelScan(const std::string& needle) const {
+        return searchMode != Mode::FullText && (isFuzzy() || needle.size() < 3)
+            && trigrams.size() >= parallelThreshold;
+    }
+
+    std::shared_ptr<Scan> startScan(const std::string& needle, bool deferred) {
+        if (!pool) {
+            pool = std::make_unique<SearchPool>();
+        }
+        auto scan = std::make_shared<Scan>();
+        scan->needle = needle;
+        scan->fuzzy = isFuzzy();
+        scan->deferred = deferred;
+        scan->allowed = taggedEntries();
+        if (scan->fuzzy) {
+            scan->boosts = usageBoosts();
+        }
+        scan->chunks = trigrams.chunks(scanChunkBytes);
+        scan->matched.resize(scan->chunks.size());
+        scan->best.resize(scan->chunks.size());
+        scan->remaining = scan->chunks.size();
+        std::vector<SearchPool::Task> tasks;
+        tasks.reserve(scan->chunks.size());
+        for (std::size_t chunk = 0; chunk < scan->chunks.size(); ++chunk) {
+            tasks.push_back([this, scan, chunk]() {
+                if (!scan->cancelled.load(std::memory_order_relaxed)) {
+                    scanChunk(*scan, chunk);
+                }
+                if (scan->remaining.fetch_sub(1) == 1 && scan->deferred && !scan->cancelled) {
+                    QMetaObject::invokeMethod(this, [this, scan]() { finishScan(scan); }, Qt::QueuedConnection);
+                }
+            });
+        }
+        pool->submit(std::move(tasks));
+        return scan;
+    }
+
+    // Runs on a pool thread; only reads the index. Each chunk keeps its best
+    // matches by the same boosted score showMatches() ranks by, so a much
+    // used entry is not cut before its bonus counts.
+    void scanChunk(Scan& scan, std::size_t chunk) const {
+        const auto& range = scan.chunks[chunk];
+        std::vector<EntryStore::EntryId>& matched = scan.matched[chunk];
+        if (!scan.fuzzy) {
+            trigrams.scan(scan.needle, range.first, range.second, matched);
+            return;
+        }
+        FuzzyMatcher matcher(scan.needle);
+        TopK<EntryStore::EntryId> best(rankedResultLimit);
+        trigrams.forEachIn(range.first, range.second,
+                           [&](EntryStore::EntryId id, std::string_view name, std::string_view value,
+                               std::uint64_t mask) {
+            if (matcher.mayMatch(mask)) {
+                int score = std::max(matcher.score(name.data(), name.size()), matcher.score(value.data(), value.size()));
+                if (score >= 0) {
+                    matched.push_back(id);
+                    if (!scan.allowed || scan.allowed->contains(id)) {
+                        best.push(score + boostOf(scan.boosts, id), id);
+                    }
+                }
+            }
+        });
+        scan.best[chunk] = best.take();
+    }
+
+    // Concatenates the chunk results, which keeps matches in index order.
+    static void mergeScan(Scan& scan, std::vector<EntryStore::EntryId>& matched,
+                          std::vector<std::pair<int, EntryStore::EntryId>>& scored) {
+        for (std::size_t chunk = 0; chunk < scan.chunks.size(); ++chunk) {
+            matched.insert(matched.end(), scan.matched[chunk].begin(), scan.matched[chunk].end());
+            scored.insert(scored.end(), scan.best[chunk].begin(), scan.best[chunk].end());
+        }
+    }
+
+    void finishScan(const std::shared_ptr<Scan>& scan) {
+        if (scan != pending || scan->cancelled) {
+            return;
+        }
+        pending.reset();
+        std::vector<EntryStore::EntryId> matched;
+        std::vector<std::pair<int, EntryStore::EntryId>> scored;
+        mergeScan(*scan, matched, scored);
+        cache.insert(scan->fuzzy, scan->needle, matched);
+        beginResetModel();
+        filtered = true;
+        ranked = scan->fuzzy;
+        showMatches(matched, scored);
+        endResetModel();
+    }
+
+    // Drops the deferred scan's result; its chunks not yet started return
+    // at once.
+    void cancelScan() {
+        if (pending) {
+            pending->cancelled = true;
+            pending.reset();
+        }
+    }
+
+    // Restarts a deferred scan that an index update cancelled while the
+    // rows were still unfiltered.
+    void resumeSearch() {
+        if (!filtered && !currentQuery.isEmpty()) {
+            search();
+        }
+    }
+
+    // Cancels and waits until no chunk is reading the index.
+    void stopScans() {
+        cancelScan();
+        if (pool) {
+            pool->waitIdle();
+        }
+    }
+
+    // Recomputes the matching source rows: in source order, or best first
+    // in the ranked modes. The match set comes from the query cache when the
+    // query was seen, or narrows a cached set it refines; only a new query
+    // searches the whole index, split over the pool when it is large.
+    void refilter() {
+        rows.clear();
+        rankOf.clear();
+        sortedFrom = 0;
+        filtered = !currentQuery.isEmpty() || hasTagFilter() || isUsageSorted();
+        ranked = !currentQuery.isEmpty() && !currentPlan && searchMode != Mode::Substring;
+        if (!filtered) {
+            return;
+        }
+        if (currentQuery.isEmpty() && !hasTagFilter()) {
+            rows.resize(static_cast<std::size_t>(entries->rowCount()));
+            std::iota(rows.begin(), rows.end(), 0);
+            orderByUsage();
+            return;
+        }
+        if (currentQuery.isEmpty()) {
+            std::vector<EntryStore::EntryId> matched;
+            taggedEntries()->forEach([&](EntryStore::EntryId id) { matched.push_back(id); });
+            showMatches(matched, {});
+            return;
+        }
+        if (currentPlan) {
+            std::shared_ptr<const NameFst> automaton = names ? names->currentAutomaton() : nullptr;
+            FilterPlan::Sources sources{trigrams, tags, automaton.get(), usesOf};
+            showMatches(currentPlan->run(sources), {});
+            return;
+        }
+        if (searchMode == Mode::FullText) {
+            std::shared_ptr<const RoaringBitmap> allowed = taggedEntries();
+            const double now = UsageIndex::currentTime();
+            showRanked(fullText.search(SearchKey::fold(currentQuery), rankedResultLimit,
+                                       [&](EntryStore::EntryId id) { return !allowed || allowed->contains(id); },
+                                       [&](EntryStore::EntryId id) {
+                return static_cast<float>(fullTextUsageBoost * usageWeight(id, now));
+            }));
+            return;
+        }
+        std::string needle = SearchKey::fold(currentQuery);
+        std::vector<EntryStore::EntryId> matched;
+        std::vector<std::pair<int, EntryStore::EntryId>> scored;
+        if (const std::vector<EntryStore::EntryId>* cached = cache.find(isFuzzy(), needle)) {
+            matched = *cached;
+            if (isFuzzy()) {
+                scored = scoreFuzzy(needle, &matched);
+            }
+        } else {
+            const std::vector<EntryStore::EntryId>* base = cache.narrowest(isFuzzy(), needle);
+            if (!base && isParallelScan(needle)) {
+                std::shared_ptr<Scan> scan = startScan(needle, false);
+                pool->waitIdle();
+                mergeScan(*scan, matched, scored);
+            } else if (isFuzzy()) {
+                scored = scoreFuzzy(needle, base);
+                matched.reserve(scored.size());
+                for (const auto& match : scored) {
+                    matched.push_back(match.second);
+                }
+            } else if (base) {
+                for (EntryStore::EntryId id : *base) {
+                    if (trigrams.contains(id, needle)) {
+                        matched.push_back(id);
+                    }
+                }
+            } else {
+                matched = trigrams.find(needle);
+            }
+            cache.insert(isFuzzy(), needle, matched);
+        }
+        showMatches(matched, scored);
+    }
+
+    // Sets rows from a match set, less what the tag filter rules out;
+    // scored holds at least the best rankedResultLimit matches that pass it
+    // when ranked, scored with their usage bonus included.
+    void showMatches(const std::vector<EntryStore::EntryId>& matched,
+                     const std::vector<std::pair<int, EntryStore::EntryId>>& scored) {
+        rows.clear();
+        rankOf.clear();
+        std::shared_ptr<const RoaringBitmap> allowed = taggedEntries();
+        if (ranked) {
+            TopK<EntryStore::EntryId> best(rankedResultLimit);
+            for (const auto& match : scored) {
+                if (!allowed || allowed->contains(match.second)) {
+                    best.push(match.first, match.second);
+                }
+            }
+            std::vector<EntryStore::EntryId> ids;
+            for (const auto& match : best.take()) {
+                ids.push_back(match.second);
+            }
+            showRanked(ids);
+            return;
+        }
+        std::vector<EntryStore::EntryId> stale;
+        const EntryStore& store = entries->store();
+        for (EntryStore::EntryId id : matched) {
+            if (allowed && !allowed->contains(id)) {
+                continue;
+            }
+            int row = store.rowOf(id);
+            if (row >= 0) {
+                rows.push_back(row);
+            } else {
+                stale.push_back(id);
+            }
+        }
+        std::sort(rows.begin(), rows.end());
+        orderByUsage();
+        dropStale(stale);
+    }
+
+    bool isUsageSorted() const { return sortByUsage && usage && !usage->isEmpty(); }
+
+    // log2(1 + score): each doubling of an entry's usage earns it the same
+    // bonus.
+    double usageWeight(EntryStore::EntryId id, double now) const {
+        return usage ? std::log2(1.0 + usage->score(id, now)) : 0.0;
+    }
+
+    UsageBoosts usageBoosts() const {
+        UsageBoosts boosts;
+        if (usage) {
+            const double now = UsageIndex::currentTime();
+            for (const UsageIndex::Record& record : usage->records()) {
+                int boost = static_cast<int>(std::lround(fuzzyUsageBoost * usageWeight(record.id, now)));
+                if (boost > 0) {
+                    boosts.emplace(record.id, boost);
+                }
+            }
+        }
+        return boosts;
+    }
+
+    static int boostOf(const UsageBoosts& boosts, EntryStore::EntryId id) {
+        auto it = boosts.find(id);
+        return it == boosts.end() ? 0 : it->second;
+    }
+
+    // For the most-used sort, moves the used entries among rows, which
+    // are ascending, to the front, best first.
+    void orderByUsage() {
+        sortedFrom = 0;
+        if (!isUsageSorted() || rows.empty()) {
+            return;
+        }
+        const EntryStore& store = entries->store();
+        std::vector<int> head;
+        usage->forEachBest(SIZE_MAX, [&](const UsageIndex::Record& record) {
+            int row = store.rowOf(record.id);
+            if (row >= 0 && std::binary_search(rows.begin(), rows.end(), row)) {
+                head.push_back(row);
+            }
+        });
+        if (head.empty()) {
+            return;
+        }
+        std::vector<int> used = head;
+        std::sort(used.begin(), used.end());
+        std::vector<int> ordered = std::move(head);
+        std::set_difference(rows.begin(), rows.end(), used.begin(), used.end(), std::back_inserter(ordered));
+        rows.swap(ordered);
+        sortedFrom = used.size();
+        for (std::size_t rank = 0; rank < sortedFrom; ++rank) {
+            rankOf.emplace(rows[rank], static_cast<int>(rank));
+        }
+    }
+
+    // Sets rows from IDs in rank order.
+    void showRanked(const std::vector<EntryStore::EntryId>& ids) {
+        std::vector<EntryStore::EntryId> stale;
+        const EntryStore& store = entries->store();
+        for (EntryStore::EntryId id : ids) {
+            int row = store.rowOf(id);
+            if (row >= 0) {
+                rankOf.emplace(row, static_cast<int>(rows.size()));
+                rows.push_back(row);
+            } else {
+                stale.push_back(id);
+            }
+        }
+        sortedFrom = rows.size();
+        dropStale(stale);
+    }
+
+    // Unindexes IDs the store no longer has: an entry replaced in place by
+    // a reload is indexed again under its new ID only.
+    void dropStale(const std::vector<EntryStore::EntryId>& stale) {
+        if (stale.empty()) {
+            return;
+        }
+        stopScans();
+        for (EntryStore::EntryId id : stale) {
+            trigrams.remove(id);
+            fullText.remove(id);
+            tags.remove(id);
+        }
+        tagged.reset();
+    }
+
+    // Fuzzy scores, usage bonus included, of the entries in ids (all entries
+    // if null) that match needle.
+    std::vector<std::pair<int, EntryStore::EntryId>> scoreFuzzy(const std::string& needle,
+                                                                const std::vector<EntryStore::EntryId>* ids) const {
+        FuzzyMatcher matcher(needle);
+        UsageBoosts boosts = usageBoosts();
+        std::vector<std::pair<int, EntryStore::EntryId>> scored;
+        auto score = [&](EntryStore::EntryId id, std::string_view name, std::string_view value,
+                         std::uint64_t mask) {
+            if (matcher.mayMatch(mask)) {
+                int best = std::max(matcher.score(name.data(), name.size()), matcher.score(value.data(), value.size()));
+                if (best >= 0) {
+                    scored.emplace_back(best + boostOf(boosts, id), id);
+                }
+            }
+        };
+        if (ids) {
+            trigrams.forEach(*ids, score);
+        } else {
+            trigrams.forEach(score);
+        }
+        return scored;
+    }
+
+    void forwardDataChanged(int first, int last, const QVector<int>& roles) {
+        if (!isFiltered()) {
+            emit dataChanged(index(first, 0), index(last, 0), roles);
+        } else if (sortedFrom > 0) {
+            if (!rows.empty()) {
+                emit dataChanged(index(0, 0), index(static_cast<int>(rows.size()) - 1, 0), roles);
+            }
+        } else if (!rows.empty()) {
+            auto begin = std::lower_bound(rows.begin(), rows.end(), first);
+            auto end = std::upper_bound(begin, rows.end(), last);
+            if (begin != end) {
+                emit dataChanged(index(static_cast<int>(begin - rows.begin()), 0),
+                                 index(static_cast<int>(end - rows.begin()) - 1, 0), roles);
+            }
+        }
+    }
+
+    EntryListModel* entries;
+    TrigramIndex trigrams;
+    Bm25Index fullText;
+    TagIndex tags;
+    QueryCache cache;
+    QString currentQuery;
+    std::shared_ptr<const FilterPlan> currentPlan; // Set when currentQuery is a filter query
+    FilterPlanCache plans;
+    const NameIndex* names = nullptr;
+    const UsageIndex* usage = nullptr;
+    std::function<std::uint32_t(EntryStore::EntryId)> usesOf; // For FilterPlan
+    bool sortByUsage = false;
+    QString currentTagFilter;
+    std::vector<std::string> includeTags; // SearchKeys
+    std::vector<std::string> excludeTags;
+    std::shared_ptr<const RoaringBitmap> tagged; // Selected by taggedEntries(); reset when stale
+    Mode searchMode = Mode::Substring;
+    bool filtered = false; // Shown state, set with rows
+    bool ranked = false;
+    std::vector<int> rows; // Matching source rows, ranked up to sortedFrom and ascending after; unused unless filtered
+    std::size_t sortedFrom = 0;
+    std::unordered_map<int, int> rankOf; // Source row -> row, for rows before sortedFrom
+    std::unique_ptr<SearchPool> pool;    // Started on the first large scan
+    std::shared_ptr<Scan> pending;       // Deferred scan for currentQuery
+};
@@ -0,0 +1,554 @@
+#pragma once
+
+#include <QChar>
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Read-only view of a string held by an EntryStore, in QString's own UTF-16
+// representation. Stays valid while the store or any copy of it is alive.
+struct EntryText {
+    const char16_t* data = nullptr;
+    int length = 0;
+
+    QString toString() const { return QString(reinterpret_cast<const QChar*>(data), length); }
+
+    EntryText mid(int position, int count) const { return {data + position, count}; }
+
+    bool operator==(const EntryText& other) const {
+        return length == other.length
+            && (length == 0 || std::memcmp(data, other.data, static_cast<std::size_t>(length) * sizeof(char16_t)) == 0);
+    }
+    bool operator!=(const EntryText& other) const { return !(*this == other); }
+};
+
+// An EntryText that keeps its arena block alive by itself, for handing a
+// value to something that may outlive the store, such as the clipboard.
+struct SharedEntryText {
+    std::shared_ptr<const char16_t> owner; // Points at the text itself
+    int length = 0;
+
+    EntryText view() const { return {owner.get(), length}; }
+};
+
+// In-memory library of entries in file order, stored as a struct of arrays.
+//
+// Text lives in append-only arena blocks of UTF-16; each entry is a slot
+// with parallel name/value arrays of block, offset and length, and a row
+// order maps rows to slots. An entry costs 52 bytes and an index node plus
+// its text, the text is decoded from UTF-8 once, straight into the arena,
+// and scanning touches contiguous memory only.
+//
+// An entry's optional tags are kept the same way, as one string with the
+// tags separated by tagSeparator.
+//
+// Every entry also has a persistent EntryId, stored as "id" in config.json
+// and in journal records, and a hash index from ID to slot, so entries are
+// found by ID in O(1) no matter how names repeat or rows move. Removing a
+// row costs one pass over the rows below it to shift them.
+//
+// Blocks are shared between copies and never written below their fill
+// mark, so a copy handed to another thread is cheap and safe to read while
+// the original keeps growing.
+//
+// For the same reason the text of a removed or replaced entry is never
+// overwritten, and its slot is not reused either, since a slot only points
+// at text. Both are left behind as garbage until removed slots outnumber
+// live ones or unreferenced text makes up over half of all text stored;
+// then the live entries are copied into fresh slots and blocks, in one
+// pass, and copies still holding the old blocks keep them alive.
+class EntryStore {
+public:
+    using EntryId = std::uint64_t;
+
+    static constexpr std::uint32_t blockUnits = 32 * 1024;
+    static constexpr char16_t tagSeparator = 0x1F; // Unit separator; never kept inside a tag
+
+    int size() const { return static_cast<int>(order.size()); }
+    bool isEmpty() const { return order.empty(); }
+
+    EntryId idAt(int row) const { return ids[slotAt(row)]; }
+    EntryText name(int row) const { return text(names[slotAt(row)]); }
+    EntryText value(int row) const { return text(values[slotAt(row)]); }
+    EntryText tagText(int row) const { return text(tagLists[slotAt(row)]); }
+
+    // The value at row without copying it: a reference into its block.
+    SharedEntryText sharedValue(int row) const {
+        const TextRef& ref = values[slotAt(row)];
+        if (ref.length == 0) {
+            return {};
+        }
+        return {std::shared_ptr<const char16_t>(blocks[ref.block], blocks[ref.block].get() + ref.offset),
+                static_cast<int>(ref.length)};
+    }
+
+    QStringList tags(int row) const {
+        QStringList list;
+        forEachTag(row, [&](EntryText tag) { list.append(tag.toString()); });
+        return list;
+    }
+
+    template <typename F>
+    void forEachTag(int row, F&& f) const {
+        EntryText all = tagText(row);
+        int start = 0;
+        for (int i = 0; i <= all.length; ++i) {
+            if (i == all.length || all.data[i] == tagSeparator) {
+                if (i > start) {
+                    f(all.mid(start, i - start));
+                }
+                start = i + 1;
+            }
+        }
+    }
+
+    // Row of the entry with the given ID, or -1.
+    int rowOf(EntryId id) const {
+        auto it = index.find(id);
+        return it == index.end() ? -1 : static_cast<int>(rows[it->second]);
+    }
+
+    void clear() { *this = EntryStore(); }
+
+    void reserve(int count) {
+        std::size_t n = static_cast<std::size_t>(count);
+        names.reserve(n);
+        values.reserve(n);
+        tagLists.reserve(n);
+        ids.reserve(n);
+        rows.reserve(n);
+        order.reserve(n);
+        index.reserve(n);
+    }
+
+    // Appends an entry under a new ID and returns it.
+    EntryId append(const QString& name, const QString& value, const QStringList& tags = QStringList()) {
+        EntryId id = nextId;
+        QString joined = joinTags(tags);
+        appendSlot(copyText(name.utf16(), name.size()), copyText(value.utf16(), value.size()),
+                   copyText(joined.utf16(), joined.size()), id);
+        return id;
+    }
+
+    // Inserts count entries copied from other, starting at its row source,
+    // under the same IDs. An ID still held by another row moves to the new
+    // one; applying a diff removes that row afterwards.
+    void insert(int row, const EntryStore& other, int source, int count) {
+        std::vector<Slot> slots;
+        slots.reserve(static_cast<std::size_t>(count));
+        for (int i = 0; i < count; ++i) {
+            EntryText name = other.name(source + i);
+            EntryText value = other.value(source + i);
+            EntryText tags = other.tagText(source + i);
+            Slot slot = newSlot(copyText(name.data, name.length), copyText(value.data, value.length),
+                                copyText(tags.data, tags.length), 0);
+            takeId(slot, other.idAt(source + i));
+            slots.push_back(slot);
+        }
+        order.insert(order.begin() + row, slots.begin(), slots.end());
+        renumberFrom(row);
+    }
+
+    // Overwrites row with other's row source, ID included, keeping its slot.
+    void replace(int row, const EntryStore& other, int source) {
+        EntryText name = other.name(source);
+        EntryText value = other.value(source);
+        EntryText tags = other.tagText(source);
+        Slot slot = slotAt(row);
+        garbageUnits += unitsOf(slot);
+        names[slot] = copyText(name.data, name.length);
+        values[slot] = copyText(value.data, value.length);
+        tagLists[slot] = copyText(tags.data, tags.length);
+        storedUnits += unitsOf(slot);
+        unindex(slot);
+        takeId(slot, other.idAt(source));
+        compactIfSparse();
+    }
+
+    void remove(int row, int count = 1) {
+        for (int i = row; i < row + count; ++i) {
+            Slot slot = slotAt(i);
+            unindex(slot);
+            rows[slot] = deadRow;
+            garbageUnits += unitsOf(slot);
+        }
+        order.erase(order.begin() + row, order.begin() + row + count);
+        renumberFrom(row);
+        compactIfSparse();
+    }
+
+    // Registers externally owned UTF-16 text, e.g. a mapped snapshot, as a
+    // block that appendView() can refer into without copying. The store
+    // keeps owner alive for as long as it or a copy of it exists.
+    std::uint32_t adoptBlock(std::shared_ptr<const char16_t> owner) {
+        blocks.push_back(std::move(owner));
+        return static_cast<std::uint32_t>(blocks.size() - 1);
+    }
+
+    void appendView(EntryId id, std::uint32_t block, std::uint32_t nameOffset, std::uint32_t nameLength,
+                    std::uint32_t valueOffset, std::uint32_t valueLength, std::uint32_t tagsOffset,
+                    std::uint32_t tagsLength) {
+        appendSlot({block, nameOffset, nameLength}, {block, valueOffset, valueLength}, {block, tagsOffset, tagsLength},
+                   id);
+    }
+
+    // Gives every entry loaded without a usable ID (none, or one already
+    // taken) a fresh one, after all stored IDs are known. Returns how many
+    // were assigned; the caller should write them back to config.json.
+    std::size_t assignMissingIds() {
+        std::size_t assigned = 0;
+        for (Slot slot : order) {
+            if (ids[slot] == 0) {
+                claimId(slot, nextId);
+                ++assigned;
+            }
+        }
+        return assigned;
+    }
+
+    // Sink interface for ConfigJournal::read() and the SAX config loader.
+    // id 0 means the item had none; see assignMissingIds().
+    void appendItem(const std::string& name, const std::string& value, EntryId id,
+                    const std::vector<std::string>& tags = {}) {
+        std::string joined;
+        for (const std::string& tag : tags) {
+            std::string clean;
+            for (char c : tag) {
+                if (c != static_cast<char>(tagSeparator)) {
+                    clean += c;
+                }
+            }
+            if (!clean.empty()) {
+                if (!joined.empty()) {
+                    joined += static_cast<char>(tagSeparator);
+                }
+                joined += clean;
+            }
+        }
+        appendSlot(decodeText(name), decodeText(value), decodeText(joined), id);
+    }
+
+    void removeItemById(EntryId id) {
+        int row = rowOf(id);
+        if (row >= 0) {
+            remove(row);
+        }
+    }
+
+    // The entries as the JSON array stored under "items" in config.json,
+    // one item per line, written straight from the arena without a DOM.
+    std::string toJson() const {
+        std::string out = "[";
+        for (int row = 0; row < size(); ++row) {
+            out += row == 0 ? "\n    {\"id\": " : ",\n    {\"id\": ";
+            out += std::to_string(idAt(row));
+            out += ", \"name\": ";
+            appendJsonString(out, name(row));
+            out += ", \"value\": ";
+            appendJsonString(out, value(row));
+            if (tagText(row).length > 0) {
+                out += ", \"tags\": [";
+                bool first = true;
+                forEachTag(row, [&](EntryText tag) {
+                    out += first ? "" : ", ";
+                    appendJsonString(out, tag);
+                    first = false;
+                });
+                out += ']';
+            }
+            out += '}';
+        }
+        out += isEmpty() ? "]" : "\n  ]";
+        return out;
+    }
+
+private:
+    using Slot = std::uint32_t;
+
+    static constexpr std::uint32_t deadRow = UINT32_MAX;
+
+    struct TextRef {
+        std::uint32_t block;
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    EntryText text(const TextRef& ref) const {
+        if (ref.length == 0) {
+            return {};
+        }
+        return {blocks[ref.block].get() + ref.offset, static_cast<int>(ref.length)};
+    }
+
+    Slot slotAt(int row) const { return order[static_cast<std::size_t>(row)]; }
+
+    // Below these, garbage is too little to be worth a copy.
+    static constexpr std::size_t compactionMinSlots = 1024;
+    static constexpr std::uint64_t compactionMinUnits = blockUnits;
+
+    std::uint64_t unitsOf(Slot slot) const {
+        return std::uint64_t(names[slot].length) + values[slot].length + tagLists[slot].length;
+    }
+
+    // Copies the live entries into a fresh store once enough of this one is
+    // garbage; see the class comment.
+    void compactIfSparse() {
+        std::size_t deadSlots = names.size() - order.size();
+        bool sparseSlots = deadSlots >= compactionMinSlots && deadSlots > order.size();
+        bool sparseText = garbageUnits >= compactionMinUnits && garbageUnits * 2 > storedUnits;
+        if (!sparseSlots && !sparseText) {
+            return;
+        }
+        EntryStore fresh;
+        fresh.reserve(size());
+        for (int row = 0; row < size(); ++row) {
+            EntryText name = this->name(row);
+            EntryText value = this->value(row);
+            EntryText tags = tagText(row);
+            fresh.appendSlot(fresh.copyText(name.data, name.length), fresh.copyText(value.data, value.length),
+                             fresh.copyText(tags.data, tags.length), idAt(row));
+        }
+        fresh.nextId = std::max(fresh.nextId, nextId);
+        *this = std::move(fresh);
+    }
+
+    Slot newSlot(const TextRef& name, const TextRef& value, const TextRef& tags, EntryId id) {
+        Slot slot = static_cast<Slot>(names.size());
+        names.push_back(name);
+        values.push_back(value);
+        tagLists.push_back(tags);
+        storedUnits += std::uint64_t(name.length) + value.length + tags.length;
+        ids.push_back(0);
+        rows.push_back(deadRow);
+        claimId(slot, id);
+        return slot;
+    }
+
+    void appendSlot(const TextRef& name, const TextRef& value, const TextRef& tags, EntryId id) {
+        Slot slot = newSlot(name, value, tags, id);
+        rows[slot] = static_cast<std::uint32_t>(order.size());
+        order.push_back(slot);
+    }
+
+    // Indexes slot under id unless id is 0 or taken, in which case the slot
+    // waits for assignMissingIds().
+    void claimId(Slot slot, EntryId id) {
+        if (id == 0 || !index.emplace(id, slot).second) {
+            return;
+        }
+        ids[slot] = id;
+        if (id >= nextId) {
+            nextId = id + 1;
+        }
+    }
+
+    // Indexes slot under id, taking it from whichever slot holds it now.
+    void takeId(Slot slot, EntryId id) {
+        auto it = index.find(id);
+        if (it != index.end()) {
+            ids[it->second] = 0;
+            index.erase(it);
+        }
+        claimId(slot, id);
+    }
+
+    void unindex(Slot slot) {
+        if (ids[slot] != 0) {
+            index.erase(ids[slot]);
+            ids[slot] = 0;
+        }
+    }
+
+    void renumberFrom(int row) {
+        for (std::size_t i = static_cast<std::size_t>(row); i < order.size(); ++i) {
+            rows[order[i]] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    // Returns room for units code units at the end of the tail block,
+    // starting a new block when it does not fit.
+    char16_t* reserveUnits(std::size_t units) {
+        if (!tail.data || tail.capacity - tail.used < units) {
+            std::uint32_t capacity = units > blockUnits ? static_cast<std::uint32_t>(units) : blockUnits;
+            std::shared_ptr<char16_t> block(new char16_t[capacity], std::default_delete<char16_t[]>());
+            tail.data = block.get();
+            tail.used = 0;
+            tail.capacity = capacity;
+            blocks.push_back(std::move(block));
+        }
+        return tail.data + tail.used;
+    }
+
+    TextRef commitUnits(std::size_t units) {
+        TextRef ref = {static_cast<std::uint32_t>(blocks.size() - 1), tail.used, static_cast<std::uint32_t>(units)};
+        tail.used += static_cast<std::uint32_t>(units);
+        return ref;
+    }
+
+    TextRef copyText(const char16_t* data, int length) {
+        if (length == 0) {
+            return {0, 0, 0};
+        }
+        char16_t* out = reserveUnits(static_cast<std::size_t>(length));
+        std::memcpy(out, data, static_cast<std::size_t>(length) * sizeof(char16_t));
+        return commitUnits(static_cast<std::size_t>(length));
+    }
+
+    TextRef copyText(const ushort* data, int length) {
+        return copyText(reinterpret_cast<const char16_t*>(data), length);
+    }
+
+    // Empty tags are dropped and separators inside a tag removed.
+    static QString joinTags(const QStringList& tags) {
+        QString joined;
+        for (QString tag : tags) {
+            tag.remove(QChar(tagSeparator));
+            if (!tag.isEmpty()) {
+                if (!joined.isEmpty()) {
+                    joined += QChar(tagSeparator);
+                }
+                joined += tag;
+            }
+        }
+        return joined;
+    }
+
+    // UTF-8 never needs more UTF-16 code units than it has bytes, so the
+    // text is decoded in place into room reserved for its byte length.
+    // Malformed sequences become U+FFFD.
+    TextRef decodeText(const std::string& utf8) {
+        if (utf8.empty()) {
+            return {0, 0, 0};
+        }
+        static const std::uint32_t minimum[] = {0, 0x80, 0x800, 0x10000};
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(utf8.data());
+        const std::size_t size = utf8.size();
+        char16_t* out = reserveUnits(size);
+        std::size_t units = 0;
+        for (std::size_t i = 0; i < size;) {
+            std::uint32_t c = in[i];
+            if (c < 0x80) {
+                out[units++] = static_cast<char16_t>(c);
+                ++i;
+                continue;
+            }
+            int extra = (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 0;
+            std::uint32_t codePoint = c & (0x3F >> extra);
+            bool valid = extra > 0 && i + extra < size;
+            for (int k = 1; valid && k <= extra; ++k) {
+                valid = (in[i + k] & 0xC0) == 0x80;
+                codePoint = (codePoint << 6) | (in[i + k] & 0x3F);
+            }
+            if (!valid || codePoint < minimum[extra] || codePoint > 0x10FFFF
+                || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+                out[units++] = 0xFFFD;
+                ++i;
+                continue;
+            }
+            i += static_cast<std::size_t>(extra) + 1;
+            if (codePoint >= 0x10000) {
+                codePoint -= 0x10000;
+                out[units++] = static_cast<char16_t>(0xD800 + (codePoint >> 10));
+                out[units++] = static_cast<char16_t>(0xDC00 + (codePoint & 0x3FF));
+            } else {
+                out[units++] = static_cast<char16_t>(codePoint);
+            }
+        }
+        return commitUnits(units);
+    }
+
+    // Appends text as a quoted JSON string in UTF-8. Unpaired surrogates
+    // become U+FFFD.
+    static void appendJsonString(std::string& out, EntryText text) {
+        static const char hex[] = "0123456789abcdef";
+        out += '"';
+        for (int i = 0; i < text.length; ++i) {
+            std::uint32_t c = text.data[i];
+            if (c >= 0xD800 && c <= 0xDBFF && i + 1 < text.length && text.data[i + 1] >= 0xDC00
+                && text.data[i + 1] <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (text.data[++i] - 0xDC00);
+            } else if (c >= 0xD800 && c <= 0xDFFF) {
+                c = 0xFFFD;
+            }
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += static_cast<char>(c);
+            } else if (c < 0x20) {
+                switch (c) {
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                default:
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xF];
+                    break;
+                }
+            } else if (c < 0x80) {
+                out += static_cast<char>(c);
+            } else if (c < 0x800) {
+                out += static_cast<char>(0xC0 | (c >> 6));
+                out += static_cast<char>(0x80 | (c & 0x3F));
+            } else if (c < 0x10000) {
+                out += static_cast<char>(0xE0 | (c >> 12));
+                out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (c & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (c >> 18));
+                out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (c & 0x3F));
+            }
+        }
+        out += '"';
+    }
+
+    // Writable end of the newest block this store allocated itself. A copy
+    // starts without one, so it never writes into blocks it shares.
+    struct Tail {
+        char16_t* data = nullptr;
+        std::uint32_t used = 0;
+        std::uint32_t capacity = 0;
+
+        Tail() = default;
+        Tail(const Tail&) {}
+        Tail(Tail&& other) noexcept
+            : data(std::exchange(other.data, nullptr)), used(std::exchange(other.used, 0)),
+              capacity(std::exchange(other.capacity, 0)) {}
+        Tail& operator=(const Tail& other) {
+            if (this != &other) {
+                data = nullptr;
+                used = capacity = 0;
+            }
+            return *this;
+        }
+        Tail& operator=(Tail&& other) noexcept {
+            data = std::exchange(other.data, nullptr);
+            used = std::exchange(other.used, 0);
+            capacity = std::exchange(other.capacity, 0);
+            return *this;
+        }
+    };
+
+    std::vector<std::shared_ptr<const char16_t>> blocks;
+    std::vector<TextRef> names;    // Indexed by slot
+    std::vector<TextRef> values;   // Indexed by slot
+    std::vector<TextRef> tagLists; // Indexed by slot
+    std::vector<EntryId> ids;      // Indexed by slot; 0 until assigned
+    std::vector<std::uint32_t> rows; // Slot -> row, deadRow once removed
+    std::vector<Slot> order;       // Row -> slot
+    std::unordered_map<EntryId, Slot> index;
+    EntryId nextId = 1;
+    std::uint64_t storedUnits = 0;  // Text units every slot ever pointed at
+    std::uint64_t garbageUnits = 0; // Of those, units no live entry points at
+    Tail tail;
+};
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <QString>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "entry_store.h"
+#include "name_fst.h"
+#include "roaring_bitmap.h"
+#include "search_key.h"
+#include "tag_index.h"
+#include "trigram_index.h"
+
+// A search query in the filter language, compiled once into the order its
+// clauses are evaluated in:
+//
+//   tag:work name:addr* value:street used:>5 -tag:old "two words"
+//
+// Every term is a clause that must hold; a leading '-' negates it. tag:
+// matches one of an entry's tags, name: and value: that field containing
+// the text, or starting with it when the text ends in '*', and used: how
+// often the entry was used (=, <, <=, >, >=). A bare term matches either
+// field. Double quotes keep spaces inside a term. Text is compared by
+// SearchKey, as in the plain search.
+//
+// Compiling sorts the clauses by how cheaply they narrow the entries: tags
+// (bitmaps), name prefixes (NameFst), text the trigram index can look up,
+// longest first, then clauses that must look at each entry, negations
+// last. Running the plan generates candidates from whichever indexed
+// clause promises the fewest and checks the other clauses, in plan order,
+// against those only; with no indexed clause it scans the whole index.
+class FilterPlan {
+public:
+    using EntryId = EntryStore::EntryId;
+
+    struct Clause {
+        enum class Kind { Text, Name, NamePrefix, Value, ValuePrefix, Tag, Used };
+        enum class Compare { Equal, Less, LessEqual, Greater, GreaterEqual };
+
+        Kind kind = Kind::Text;
+        bool negated = false;
+        std::string key; // SearchKey of the text or tag
+        Compare compare = Compare::Equal; // used: only
+        std::uint32_t count = 0;          // used: only
+    };
+
+    // What a plan runs against. names is null while the automaton lags the
+    // entries, and uses empty until usage is tracked, when every entry
+    // counts as never used.
+    struct Sources {
+        const TrigramIndex& trigrams;
+        const TagIndex& tags;
+        const NameFst* names;
+        const std::function<std::uint32_t(EntryId)>& uses;
+    };
+
+    // Whether query is written in the filter language rather than being
+    // plain text for the search mode: it has a field or a negated term.
+    static bool isFilter(const QString& query) {
+        for (const QString& term : terms(query)) {
+            if ((term.size() > 1 && term.startsWith(QLatin1Char('-'))) || !field(term).isEmpty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static FilterPlan compile(const QString& query) {
+        FilterPlan plan;
+        for (const QString& term : terms(query)) {
+            Clause clause;
+            if (parse(term, clause)) {
+                plan.steps.push_back(std::move(clause));
+            }
+        }
+        std::stable_sort(plan.steps.begin(), plan.steps.end(), [](const Clause& a, const Clause& b) {
+            int rankA = rank(a);
+            int rankB = rank(b);
+            if (rankA != rankB) {
+                return rankA < rankB;
+            }
+            return rankA == trigramRank && a.key.size() > b.key.size();
+        });
+        return plan;
+    }
+
+    const std::vector<Clause>& clauses() const { return steps; }
+
+    bool isEmpty() const { return steps.empty(); }
+
+    // IDs of the entries every clause holds for, in no particular order.
+    // IDs from the name automaton that the trigram index no longer has are
+    // left out.
+    std::vector<EntryId> run(const Sources& sources) const {
+        std::vector<std::string> include;
+        std::vector<std::string> exclude;
+        for (const Clause& clause : steps) {
+            if (clause.kind == Clause::Kind::Tag) {
+                (clause.negated ? exclude : include).push_back(clause.key);
+            }
+        }
+        // With a required tag, one selection settles every tag clause.
+        RoaringBitmap tagged;
+        const bool selectTags = !include.empty();
+        if (selectTags) {
+            tagged = sources.tags.select(include, exclude);
+        }
+
+        // The generator: the positive indexed clause with the fewest
+        // candidates, or none for a full scan.
+        const Clause* source = nullptr;
+        bool fromNames = false; // Whether source is looked up in the automaton
+        std::size_t fewest = selectTags ? tagged.cardinality() : SIZE_MAX;
+        for (const Clause& clause : steps) {
+            if (clause.negated) {
+                continue;
+            }
+            std::size_t estimate = SIZE_MAX;
+            const bool byName = clause.kind == Clause::Kind::NamePrefix && sources.names;
+            if (byName) {
+                estimate = sources.names->countWithPrefix(clause.key);
+            } else if (clause.kind != Clause::Kind::Tag && clause.kind != Clause::Kind::Used
+                       && clause.key.size() >= 3) {
+                estimate = sources.trigrams.estimate(clause.key);
+            }
+            if (estimate < fewest) {
+                fewest = estimate;
+                source = &clause;
+                fromNames = byName;
+            }
+        }
+        std::vector<EntryId> result;
+        if (fewest == 0) {
+            return result;
+        }
+
+        std::vector<EntryId> candidates;
+        bool scanAll = false;
+        if (source && fromNames) {
+            candidates = sources.names->idsWithPrefix(source->key);
+        } else if (source) {
+            candidates = sources.trigrams.find(source->key);
+        } else if (selectTags) {
+            tagged.forEach([&](EntryId id) { candidates.push_back(id); });
+        } else {
+            scanAll = true;
+        }
+
+        // An exact generator need not be checked again.
+        const Clause* settled = source && (fromNames || source->kind == Clause::Kind::Text) ? source : nullptr;
+        const bool tagsSettled = selectTags && !source;
+        auto check = [&](EntryId id, std::string_view name, std::string_view value, std::uint64_t) {
+            for (const Clause& clause : steps) {
+                if (&clause == settled) {
+                    continue;
+                }
+                if (clause.kind == Clause::Kind::Tag && selectTags) {
+                    if (tagsSettled) {
+                        continue;
+                    }
+                    if (!tagged.contains(id)) {
+                        return;
+                    }
+                } else if (holds(clause, sources, id, name, value) == clause.negated) {
+                    return;
+                }
+            }
+            result.push_back(id);
+        };
+        if (scanAll) {
+            sources.trigrams.forEach(check);
+        } else {
+            sources.trigrams.forEach(candidates, check);
+        }
+        return result;
+    }
+
+private:
+    static constexpr int trigramRank = 2;
+
+    // Splits query at spaces outside double quotes, dropping the quotes.
+    static std::vector<QString> terms(const QString& query) {
+        std::vector<QString> result;
+        QString term;
+        bool quoted = false;
+        for (int i = 0; i <= query.size(); ++i) {
+            if (i < query.size() && query[i] == QLatin1Char('"')) {
+                quoted = !quoted;
+            } else if (i < query.size() && (quoted || !query[i].isSpace())) {
+                term += query[i];
+            } else if (!term.isEmpty()) {
+                result.push_back(term);
+                term.clear();
+            }
+        }
+        return result;
+    }
+
+    // The field name of a term such as "-tag:old", lower case, or empty.
+    static QString field(const QString& term) {
+        int start = term.startsWith(QLatin1Char('-')) ? 1 : 0;
+        int colon = term.indexOf(QLatin1Char(':'));
+        if (colon <= start) {
+            return QString();
+        }
+        QString name = term.mid(start, colon - start).toLower();
+        if (name == QLatin1String("tag") || name == QLatin1String("name") || name == QLatin1String("value")
+            || name == QLatin1String("used")) {
+            return name;
+        }
+        return QString();
+    }
+
+    // False for terms that constrain nothing, such as "value:".
+    static bool parse(QString term, Clause& clause) {
+        QString name = field(term);
+        clause.negated = term.size() > 1 && term.startsWith(QLatin1Char('-'));
+        if (clause.negated) {
+            term.remove(0, 1);
+        }
+        QString text = name.isEmpty() ? term : term.mid(term.indexOf(QLatin1Char(':')) + 1);
+        if (name == QLatin1String("used")) {
+            return parseCount(text, clause) || parse(QString(), term, clause);
+        }
+        return parse(name, text, clause);
+    }
+
+    static bool parse(const QString& name, QString text, Clause& clause) {
+        const bool prefix = text.endsWith(QLatin1Char('*'));
+        if (prefix && (name == QLatin1String("name") || name == QLatin1String("value"))) {
+            text.chop(1);
+            clause.kind = name == QLatin1String("name") ? Clause::Kind::NamePrefix : Clause::Kind::ValuePrefix;
+        } else if (name == QLatin1String("name")) {
+            clause.kind = Clause::Kind::Name;
+        } else if (name == QLatin1String("value")) {
+            clause.kind = Clause::Kind::Value;
+        } else if (name == QLatin1String("tag")) {
+            clause.kind = Clause::Kind::Tag;
+        } else {
+            clause.kind = Clause::Kind::Text;
+        }
+        clause.key = SearchKey::fold(text);
+        return !clause.key.empty();
+    }
+
+    // "5", "=5", ">5", ">=5", "<5" or "<=5".
+    static bool parseCount(const QString& text, Clause& clause) {
+        static const std::pair<const char*, Clause::Compare> operators[] = {
+            {">=", Clause::Compare::GreaterEqual}, {"<=", Clause::Compare::LessEqual},
+            {">", Clause::Compare::Greater}, {"<", Clause::Compare::Less}, {"=", Clause::Compare::Equal}};
+        QString number = text;
+        clause.compare = Clause::Compare::Equal;
+        for (const auto& op : operators) {
+            if (text.startsWith(QLatin1String(op.first))) {
+                clause.compare = op.second;
+                number = text.mid(static_cast<int>(std::char_traits<char>::length(op.first)));
+                break;
+            }
+        }
+        bool ok = false;
+        clause.count = number.toUInt(&ok);
+        clause.kind = Clause::Kind::Used;
+        return ok;
+    }
+
+    // Lower ranks narrow more for less work and run first.
+    static int rank(const Clause& clause) {
+        int base = 0;
+        switch (clause.kind) {
+        case Clause::Kind::Tag: base = 0; break;
+        case Clause::Kind::NamePrefix: base = 1; break;
+        case Clause::Kind::Used: base = 3; break;
+        default: base = clause.key.size() >= 3 ? trigramRank : 4; break;
+        }
+        return clause.negated ? base + 5 : base;
+    }
+
+    static bool holds(const Clause& clause, const Sources& sources, EntryId id, std::string_view name,
+                      std::string_view value) {
+        switch (clause.kind) {
+        case Clause::Kind::Text:
+            return name.find(clause.key) != std::string_view::npos || value.find(clause.key) != std::string_view::npos;
+        case Clause::Kind::Name:
+            return name.find(clause.key) != std::string_view::npos;
+        case Clause::Kind::NamePrefix:
+            return name.substr(0, clause.key.size()) == clause.key;
+        case Clause::Kind::Value:
+            return value.find(clause.key) != std::string_view::npos;
+        case Clause::Kind::ValuePrefix:
+            return value.substr(0, clause.key.size()) == clause.key;
+        case Clause::Kind::Tag: {
+            const RoaringBitmap* tagged = sources.tags.find(clause.key);
+            return tagged && tagged->contains(id);
+        }
+        case Clause::Kind::Used: {
+            std::uint32_t uses = sources.uses ? sources.uses(id) : 0;
+            switch (clause.compare) {
+            case Clause::Compare::Less: return uses < clause.count;
+            case Clause::Compare::LessEqual: return uses <= clause.count;
+            case Clause::Compare::Greater: return uses > clause.count;
+            case Clause::Compare::GreaterEqual: return uses >= clause.count;
+            default: return uses == clause.count;
+            }
+        }
+        }
+        return false;
+    }
+
+    std::vector<Clause> steps; // In evaluation order
+};
+
+// Compiled plans of recent filter queries, keyed by query text. Plans only
+// depend on the text, so entries never go stale.
+class FilterPlanCache {
+public:
+    static constexpr std::size_t capacity = 64;
+
+    std::shared_ptr<const FilterPlan> plan(const QString& query) {
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->first == query) {
+                std::shared_ptr<const FilterPlan> found = it->second;
+                if (std::next(it) != entries.end()) {
+                    entries.erase(it);
+                    entries.emplace_back(query, found);
+                }
+                return found;
+            }
+        }
+        if (entries.size() == capacity) {
+            entries.pop_front();
+        }
+        entries.emplace_back(query, std::make_shared<const FilterPlan>(FilterPlan::compile(query)));
+        return entries.back().second;
+    }
+
+private:
+    std::deque<std::pair<QString, std::shared_ptr<const FilterPlan>>> entries; // Least recently used first
+};
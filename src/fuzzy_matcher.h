@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define EASYINFODROP_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// fzf-style fuzzy matching of a pattern against text, both SearchKeys
+// (folded UTF-8): the pattern's bytes must occur as a subsequence, and matches score higher when
+// they start words and run consecutively, lower when spread out.
+//
+// Matching is a forward scan that finds each pattern character in turn
+// (the prefilter), a backward scan from the last one to tighten the window,
+// and a scoring pass over that window only. The forward scan dominates on
+// non-matching text and runs on an SSE2 or AVX2 kernel when the CPU has
+// one, chosen at runtime; the scalar kernel is the fallback everywhere
+// else.
+class FuzzyMatcher {
+public:
+    enum class Kernel { Scalar, Sse2, Avx2 };
+
+    static constexpr int scoreMatch = 16;
+    static constexpr int scoreGapStart = -3;
+    static constexpr int scoreGapExtension = -1;
+    static constexpr int bonusBoundary = scoreMatch / 2;
+    static constexpr int bonusNonWord = scoreMatch / 2 - 2;
+    static constexpr int bonusConsecutive = -(scoreGapStart + scoreGapExtension);
+    static constexpr int bonusFirstCharMultiplier = 2;
+
+    explicit FuzzyMatcher(std::string pattern, Kernel kernel = bestKernel())
+        : pattern(std::move(pattern)), mask(charMask(this->pattern.data(), this->pattern.size())),
+          find(findFor(kernel)) {}
+
+    static Kernel bestKernel() {
+#ifdef EASYINFODROP_X86_DISPATCH
+        static const Kernel best = []() {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return Kernel::Avx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return Kernel::Sse2;
+            }
+            return Kernel::Scalar;
+        }();
+        return best;
+#else
+        return Kernel::Scalar;
+#endif
+    }
+
+    static const char* kernelName(Kernel kernel) {
+        switch (kernel) {
+        case Kernel::Avx2: return "AVX2";
+        case Kernel::Sse2: return "SSE2";
+        default: return "scalar";
+        }
+    }
+
+    // One bit per byte value modulo 64, so text whose mask lacks a bit of
+    // the pattern's mask cannot match and is skipped without a scan.
+    static std::uint64_t charMask(const char* text, std::size_t length) {
+        std::uint64_t bits = 0;
+        for (std::size_t i = 0; i < length; ++i) {
+            bits |= std::uint64_t(1) << (static_cast<unsigned char>(text[i]) & 63);
+        }
+        return bits;
+    }
+
+    bool isEmpty() const { return pattern.empty(); }
+
+    bool mayMatch(std::uint64_t textMask) const { return (textMask & mask) == mask; }
+
+    // Score of the pattern in text, or -1 if it is not a subsequence.
+    int score(const char* text, std::size_t length) const {
+        const std::size_t m = pattern.size();
+        if (m == 0 || length < m) {
+            return -1;
+        }
+        // Forward: earliest position of each pattern character in turn.
+        std::size_t pos = 0;
+        for (std::size_t i = 0; i < m; ++i) {
+            pos = find(text, pos, length, pattern[i]);
+            if (pos == length) {
+                return -1;
+            }
+            ++pos;
+        }
+        // Backward from the last match: the latest start that still fits,
+        // which gives the shortest window ending there.
+        std::size_t end = pos;
+        std::size_t start = end;
+        for (std::size_t i = m; i-- > 0;) {
+            do {
+                --start;
+            } while (text[start] != pattern[i]);
+        }
+        return scoreWindow(text, start, end);
+    }
+
+private:
+    using FindFn = std::size_t (*)(const char*, std::size_t, std::size_t, char);
+
+    static FindFn findFor(Kernel kernel) {
+#ifdef EASYINFODROP_X86_DISPATCH
+        if (kernel == Kernel::Avx2) {
+            return findAvx2;
+        }
+        if (kernel == Kernel::Sse2) {
+            return findSse2;
+        }
+#else
+        (void)kernel;
+#endif
+        return findScalar;
+    }
+
+    // First position of c in text[from, length), or length.
+    static std::size_t findScalar(const char* text, std::size_t from, std::size_t length, char c) {
+        for (std::size_t i = from; i < length; ++i) {
+            if (text[i] == c) {
+                return i;
+            }
+        }
+        return length;
+    }
+
+#ifdef EASYINFODROP_X86_DISPATCH
+    // Plain SSE2 byte compares; they beat SSE4.2's PCMPESTRI for a single
+    // character.
+    __attribute__((target("sse2")))
+    static std::size_t findSse2(const char* text, std::size_t from, std::size_t length, char c) {
+        const __m128i needle = _mm_set1_epi8(c);
+        std::size_t i = from;
+        for (; i + 16 <= length; i += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+            unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+            if (bits != 0) {
+                return i + static_cast<std::size_t>(__builtin_ctz(bits));
+            }
+        }
+        return findScalar(text, i, length, c);
+    }
+
+    __attribute__((target("avx2")))
+    static std::size_t findAvx2(const char* text, std::size_t from, std::size_t length, char c) {
+        const __m256i needle = _mm256_set1_epi8(c);
+        std::size_t i = from;
+        for (; i + 32 <= length; i += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+            unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+            if (bits != 0) {
+                return i + static_cast<std::size_t>(__builtin_ctz(bits));
+            }
+        }
+        return findScalar(text, i, length, c);
+    }
+#endif
+
+    // Bytes of multi-byte characters count as word bytes.
+    static bool isWordByte(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || static_cast<unsigned char>(c) >= 0x80;
+    }
+
+    static int bonusAt(const char* text, std::size_t i) {
+        if (i == 0) {
+            return bonusBoundary;
+        }
+        char previous = text[i - 1];
+        if (isWordByte(previous) || !isWordByte(text[i])) {
+            return 0;
+        }
+        switch (previous) {
+        case ' ': case '\t': case '\n': case '\0':
+        case '-': case '_': case '/': case '.': case ',': case ':': case ';':
+            return bonusBoundary;
+        default:
+            return bonusNonWord;
+        }
+    }
+
+    int scoreWindow(const char* text, std::size_t start, std::size_t end) const {
+        int total = 0;
+        int run = 0;        // Length of the current consecutive run
+        int runBonus = 0;   // Bonus of the run's first character
+        bool inGap = false;
+        std::size_t p = 0;
+        for (std::size_t i = start; i < end && p < pattern.size(); ++i) {
+            if (text[i] != pattern[p]) {
+                total += inGap ? scoreGapExtension : scoreGapStart;
+                inGap = true;
+                run = 0;
+                continue;
+            }
+            int bonus = bonusAt(text, i);
+            if (run == 0) {
+                runBonus = bonus;
+            } else {
+                // A run is as good as the boundary it started on.
+                bonus = std::max({bonus, runBonus, bonusConsecutive});
+            }
+            total += scoreMatch + (p == 0 ? bonus * bonusFirstCharMultiplier : bonus);
+            inGap = false;
+            ++run;
+            ++p;
+        }
+        return total;
+    }
+
+    std::string pattern;
+    std::uint64_t mask;
+    FindFn find;
+};
+
+// Keeps the k best (score, item) pairs seen; ties go to the smaller item.
+template <typename Item, typename Score = int>
+class TopK {
+public:
+    explicit TopK(std::size_t k) : k(k) { heap.reserve(k); }
+
+    void push(Score score, Item item) {
+        if (k == 0) {
+            return;
+        }
+        if (heap.size() < k) {
+            heap.emplace_back(score, item);
+            std::push_heap(heap.begin(), heap.end(), better);
+        } else if (better(Entry(score, item), heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = Entry(score, item);
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+
+    // Best first.
+    std::vector<std::pair<Score, Item>> take() {
+        std::sort(heap.begin(), heap.end(), better);
+        return std::move(heap);
+    }
+
+private:
+    using Entry = std::pair<Score, Item>;
+
+    // Used as the heap's less-than, so the worst entry is on top.
+    static bool better(const Entry& a, const Entry& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    }
+
+    std::size_t k;
+    std::vector<Entry> heap;
+};
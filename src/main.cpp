@@ -1,6 +1,6 @@
 #include <QApplication>
 #include <QMainWindow>
-#include <QListWidget>
+#include <QListView>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -16,104 +16,161 @@
 #include <QStatusBar>
 #include <QMenuBar>
 #include <QActionGroup>
+#include <QThread>
+#include <QCompleter>
+#include <QStringListModel>
+#include <QTimer>
+#include <QShortcut>
+#include <QSpinBox>
 #include <nlohmann/json.hpp>
+#include "config_watcher.h"
+#include "entry_list_model.h"
+#include "entry_mime_data.h"
+#include "entry_search_model.h"
+#include "name_index.h"
+#include "persistence_worker.h"
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <string>
-#ifdef __linux__
-#include <X11/Xlib.h>
-#include <X11/keysym.h>
-#endif
+// Last, as Xlib defines macros such as None and KeyPress that clash with Qt.
+#include "paste_engine.h"
 
 using json = nlohmann::json;
 
-class DraggableListWidget : public QListWidget {
+// Offers value on the clipboard, without copying it, and says so in
+// window's status bar if there is one. False if there is no clipboard.
+static bool copyToClipboard(QMainWindow* window, const SharedEntryText& value) {
+    QClipboard* clipboard = QApplication::clipboard();
+    if (!clipboard) {
+        if (window) {
+            window->statusBar()->showMessage("Failed to get clipboard", 5000);
+        }
+        return false;
+    }
+    clipboard->setMimeData(new EntryMimeData(value));
+    if (window) {
+        window->statusBar()->showMessage(QString("Copied to clipboard: %1").arg(EntryListModel::preview(value.view())), 5000);
+    }
+    return true;
+}
+
+// A press only turns into a drag once the pointer has moved
+// QApplication::startDragDistance() from where it went down, and each
+// press-move-release gesture starts at most one drag, so jitter during a
+// click neither drags nor rewrites the clipboard.
+class DraggableListView : public QListView {
     Q_OBJECT
 public:
-    DraggableListWidget(QWidget* parent = nullptr) : QListWidget(parent) {
+    DraggableListView(QWidget* parent = nullptr) : QListView(parent) {
         setSelectionMode(QAbstractItemView::SingleSelection);
+        setUniformItemSizes(true);
         setDragEnabled(true);
         setAcceptDrops(false);
     }
 
+    void setPasteEngine(PasteEngine* engine) { paster = engine; }
+
+    // Whether drags type the value out as key presses instead of pasting
+    // it, for targets that block pasting.
+    void setTypeOut(bool enabled) { typeOut = enabled; }
+
+    // Where dragged values are read from; indexes are matched by IdRole.
+    void setEntryModel(const EntryListModel* model) { entries = model; }
+
+signals:
+    void entryDragged(const QModelIndex& index);
+
 protected:
+    void mousePressEvent(QMouseEvent* event) override {
+        QListView::mousePressEvent(event);
+        gesture = GestureCounters();
+        if (event->button() == Qt::LeftButton && indexAt(event->pos()).isValid()) {
+            dragState = DragState::Pressed;
+            pressPos = event->pos();
+            pressIndex = indexAt(event->pos());
+        } else {
+            dragState = DragState::Idle;
+        }
+    }
+
     void mouseMoveEvent(QMouseEvent* event) override {
-        if (!(event->buttons() & Qt::LeftButton)) {
+        ++gesture.moves;
+        if (dragState != DragState::Pressed || !(event->buttons() & Qt::LeftButton)) {
             return;
         }
-        QListWidgetItem* item = itemAt(event->pos());
-        if (!item) {
+        if ((event->pos() - pressPos).manhattanLength() < QApplication::startDragDistance()) {
             return;
         }
-        startDrag(item);
+        dragState = DragState::Dragging;
+        if (pressIndex.isValid()) {
+            startDrag(pressIndex);
+        }
+    }
+
+    void mouseReleaseEvent(QMouseEvent* event) override {
+        QListView::mouseReleaseEvent(event);
+        dragState = DragState::Idle;
     }
 
 private:
-    void startDrag(QListWidgetItem* item) {
-        QString value = item->data(Qt::UserRole).toString();
+    // Idle until the left button goes down on an entry; Pressed until it
+    // comes up or moves far enough; Dragging until the next press or
+    // release, ignoring further moves.
+    enum class DragState { Idle, Pressed, Dragging };
+
+    // What the current gesture did, reported after the drop to show that a
+    // drag costs one clipboard write and one paste however many moves it
+    // took.
+    struct GestureCounters {
+        int moves = 0;
+        int clipboardWrites = 0;
+        int pasteRequests = 0;
+    };
+
+    // The drag and the clipboard each get an EntryMimeData referring to
+    // the value in the store; neither copies it unless it is asked for.
+    void startDrag(const QModelIndex& index) {
+        if (!entries) {
+            return;
+        }
+        int row = entries->store().rowOf(index.data(EntryListModel::IdRole).toULongLong());
+        if (row < 0) {
+            return;
+        }
+        SharedEntryText value = entries->store().sharedValue(row);
         if (QMainWindow* mainWindow = qobject_cast<QMainWindow*>(this->window())) {
-            mainWindow->statusBar()->showMessage(QString("Starting drag with value: %1").arg(value), 5000);
+            mainWindow->statusBar()->showMessage(QString("Starting drag with value: %1").arg(EntryListModel::preview(value.view())), 5000);
         }
 
-        QMimeData* mimeData = new QMimeData;
-        mimeData->setText(value);
-
         QDrag* drag = new QDrag(this);
-        drag->setMimeData(mimeData);
-        copyToClipboard(value);
-#ifdef __linux__
-        simulatePaste();
-#endif
-        drag->exec(Qt::CopyAction);
-    }
-
-    void copyToClipboard(const QString& value) {
-        QClipboard* clipboard = QApplication::clipboard();
-        if (clipboard) {
-            clipboard->setText(value);
-            if (QMainWindow* mainWindow = qobject_cast<QMainWindow*>(this->window())) {
-                mainWindow->statusBar()->showMessage(QString("Copied to clipboard: %1").arg(value), 5000);
-            }
-        } else {
-            if (QMainWindow* mainWindow = qobject_cast<QMainWindow*>(this->window())) {
-                mainWindow->statusBar()->showMessage("Failed to get clipboard", 5000);
-            }
+        drag->setMimeData(new EntryMimeData(value));
+        emit entryDragged(index);
+        if (copyToClipboard(qobject_cast<QMainWindow*>(window()), value)) {
+            ++gesture.clipboardWrites;
         }
-    }
-
 #ifdef __linux__
-    void simulatePaste() {
-        Display* display = XOpenDisplay(nullptr);
-        if (!display) {
-            if (QMainWindow* mainWindow = qobject_cast<QMainWindow*>(this->window())) {
-                mainWindow->statusBar()->showMessage("Error: Cannot open X display.", 5000);
-            }
-            return;
+        if (paster && typeOut) {
+            paster->requestType(value);
+            ++gesture.pasteRequests;
+        } else if (paster) {
+            paster->requestPaste();
+            ++gesture.pasteRequests;
         }
-        Window window = DefaultRootWindow(display);
-        XKeyEvent event = {};
-        event.display = display;
-        event.window = window;
-        event.root = window;
-        event.subwindow = None;
-        event.time = CurrentTime;
-        event.same_screen = True;
-        event.state = ControlMask;
-        event.type = KeyPress;
-        event.keycode = XKeysymToKeycode(display, XK_v);
-        XSendEvent(display, window, True, KeyPressMask, (XEvent*)&event);
-        event.type = KeyRelease;
-        XSendEvent(display, window, True, KeyReleaseMask, (XEvent*)&event);
-        event.keycode = XKeysymToKeycode(display, XK_Control_L);
-        XSendEvent(display, window, True, KeyReleaseMask, (XEvent*)&event);
-        XFlush(display);
-        XCloseDisplay(display);
+#endif
+        drag->exec(Qt::CopyAction);
         if (QMainWindow* mainWindow = qobject_cast<QMainWindow*>(this->window())) {
-            mainWindow->statusBar()->showMessage("Simulated paste event", 5000);
+            mainWindow->statusBar()->showMessage(QString("Dropped value after %1 move(s): %2 clipboard write(s), %3 paste(s)")
+                .arg(gesture.moves).arg(gesture.clipboardWrites).arg(gesture.pasteRequests), 5000);
         }
     }
-#endif
+
+    const EntryListModel* entries = nullptr;
+    PasteEngine* paster = nullptr;
+    bool typeOut = false;
+    DragState dragState = DragState::Idle;
+    QPoint pressPos;
+    QPersistentModelIndex pressIndex; // Survives the list refiltering mid-gesture
+    GestureCounters gesture;
 };
 
 class AddEntryDialog : public QDialog {
@@ -125,9 +182,12 @@ public:
         
         nameEdit = new QLineEdit(this);
         valueEdit = new QLineEdit(this);
+        tagsEdit = new QLineEdit(this);
+        tagsEdit->setPlaceholderText("Optional, comma-separated");
         
         layout->addRow("Name:", nameEdit);
         layout->addRow("Value:", valueEdit);
+        layout->addRow("Tags:", tagsEdit);
         
         QHBoxLayout* buttonLayout = new QHBoxLayout();
         QPushButton* okButton = new QPushButton("OK", this);
@@ -144,15 +204,76 @@ public:
     QString getName() const { return nameEdit->text(); }
     QString getValue() const { return valueEdit->text(); }
 
+    QStringList getTags() const {
+        QStringList tags;
+        for (const QString& tag : tagsEdit->text().split(QLatin1Char(','))) {
+            if (!tag.trimmed().isEmpty()) {
+                tags.append(tag.trimmed());
+            }
+        }
+        return tags;
+    }
+
 private:
     QLineEdit* nameEdit;
     QLineEdit* valueEdit;
+    QLineEdit* tagsEdit;
+};
+
+class AddSequenceDialog : public QDialog {
+    Q_OBJECT
+public:
+    AddSequenceDialog(QWidget* parent = nullptr) : QDialog(parent) {
+        setWindowTitle("Add Sequence");
+        QFormLayout* layout = new QFormLayout(this);
+
+        nameEdit = new QLineEdit(this);
+        entriesEdit = new QLineEdit(this);
+        entriesEdit->setPlaceholderText("Entry names in form order, comma-separated");
+        delaySpin = new QSpinBox(this);
+        delaySpin->setRange(0, 5000);
+        delaySpin->setSuffix(" ms");
+
+        layout->addRow("Name:", nameEdit);
+        layout->addRow("Entries:", entriesEdit);
+        layout->addRow("Pause after Tab:", delaySpin);
+
+        QHBoxLayout* buttonLayout = new QHBoxLayout();
+        QPushButton* okButton = new QPushButton("OK", this);
+        QPushButton* cancelButton = new QPushButton("Cancel", this);
+        buttonLayout->addWidget(okButton);
+        buttonLayout->addWidget(cancelButton);
+
+        layout->addRow(buttonLayout);
+
+        connect(okButton, &QPushButton::clicked, this, &AddSequenceDialog::accept);
+        connect(cancelButton, &QPushButton::clicked, this, &AddSequenceDialog::reject);
+    }
+
+    QString getName() const { return nameEdit->text().trimmed(); }
+    int getFieldDelay() const { return delaySpin->value(); }
+
+    QStringList getEntryNames() const {
+        QStringList names;
+        for (const QString& name : entriesEdit->text().split(QLatin1Char(','))) {
+            if (!name.trimmed().isEmpty()) {
+                names.append(name.trimmed());
+            }
+        }
+        return names;
+    }
+
+private:
+    QLineEdit* nameEdit;
+    QLineEdit* entriesEdit;
+    QSpinBox* delaySpin;
 };
 
 class EasyInfoDropWindow : public QMainWindow {
     Q_OBJECT
 public:
-    EasyInfoDropWindow(const json& config, QWidget* parent = nullptr) : QMainWindow(parent) {
+    EasyInfoDropWindow(PersistenceWorker* worker, PasteEngine* paster, QWidget* parent = nullptr)
+        : QMainWindow(parent), worker(worker), paster(paster) {
         setWindowTitle("EasyInfoDrop");
         resize(300, 300); // Increased for longer display text
 
@@ -160,11 +281,56 @@ public:
         QVBoxLayout* layout = new QVBoxLayout(centralWidget);
         setCentralWidget(centralWidget);
 
-        listWidget = new DraggableListWidget(this);
-        currentConfig = config.contains("items") && config["items"].is_array() ? config["items"] : json::array();
-        loadFields(currentConfig);
-        connect(listWidget, &QListWidget::itemClicked, this, &EasyInfoDropWindow::onItemClicked);
-        layout->addWidget(listWidget);
+        searchEdit = new QLineEdit(this);
+        searchEdit->setPlaceholderText("Search");
+        searchEdit->setClearButtonEnabled(true);
+        layout->addWidget(searchEdit);
+
+        tagFilterEdit = new QLineEdit(this);
+        tagFilterEdit->setPlaceholderText("Tags, e.g. work email -old");
+        tagFilterEdit->setClearButtonEnabled(true);
+        layout->addWidget(tagFilterEdit);
+
+        listView = new DraggableListView(this);
+        model = new EntryListModel(this);
+        searchModel = new EntrySearchModel(model, this);
+        listView->setModel(searchModel);
+        listView->setEntryModel(model);
+        connect(searchEdit, &QLineEdit::textChanged, searchModel, &EntrySearchModel::setQuery);
+        connect(tagFilterEdit, &QLineEdit::textChanged, searchModel, &EntrySearchModel::setTagFilter);
+
+        names = new NameIndex(model, this);
+        searchModel->setNameIndex(names);
+        completions = new QStringListModel(this);
+        QCompleter* completer = new QCompleter(completions, this);
+        completer->setCaseSensitivity(Qt::CaseInsensitive);
+        completer->setCompletionMode(QCompleter::PopupCompletion);
+        searchEdit->setCompleter(completer);
+        connect(searchEdit, &QLineEdit::textEdited, this, &EasyInfoDropWindow::updateCompletions);
+        connect(listView, &QListView::clicked, this, &EasyInfoDropWindow::onItemClicked);
+        connect(listView, &DraggableListView::entryDragged, this, &EasyInfoDropWindow::noteUse);
+        listView->setPasteEngine(paster);
+        connect(paster, &PasteEngine::pasted, this, [this](qint64 latencyUs) {
+            statusBar()->showMessage(QString("Simulated paste in %1 ms").arg(latencyUs / 1000.0, 0, 'f', 2), 5000);
+        });
+        connect(paster, &PasteEngine::typed, this, [this](int characters, qint64 elapsedUs) {
+            double seconds = elapsedUs / 1e6;
+            statusBar()->showMessage(QString("Typed %1 character(s) in %2 ms (%3 characters/s)")
+                .arg(characters).arg(elapsedUs / 1000.0, 0, 'f', 1).arg(seconds > 0 ? characters / seconds : 0.0, 0, 'f', 0), 5000);
+        });
+        connect(paster, &PasteEngine::filled, this, [this](int fields, int characters, qint64 elapsedUs) {
+            statusBar()->showMessage(QString("Filled %1 field(s), %2 character(s), in %3 ms")
+                .arg(fields).arg(characters).arg(elapsedUs / 1000.0, 0, 'f', 1), 5000);
+        });
+        connect(paster, &PasteEngine::failed, this, [this](const QString& message) {
+            statusBar()->showMessage(message, 5000);
+        });
+        searchModel->setUsage(&usage);
+        usageSaveTimer = new QTimer(this);
+        usageSaveTimer->setSingleShot(true);
+        usageSaveTimer->setInterval(usageSaveDelayMs);
+        connect(usageSaveTimer, &QTimer::timeout, this, &EasyInfoDropWindow::saveUsage);
+        layout->addWidget(listView);
 
         QHBoxLayout* buttonLayout = new QHBoxLayout();
         pinButton = new QPushButton("Pin", this);
@@ -200,17 +366,98 @@ public:
         viewGroup->addAction(justValuesAction);
         viewGroup->setExclusive(true);
 
+        viewMenu->addSeparator();
+        QActionGroup* searchGroup = new QActionGroup(this);
+        searchGroup->setExclusive(true);
+        auto addSearchMode = [&](const QString& text, EntrySearchModel::Mode mode) {
+            QAction* action = new QAction(text, this);
+            action->setCheckable(true);
+            action->setChecked(mode == searchModel->mode());
+            viewMenu->addAction(action);
+            searchGroup->addAction(action);
+            connect(action, &QAction::triggered, this, [this, mode]() { searchModel->setMode(mode); });
+        };
+        addSearchMode("Substring Search", EntrySearchModel::Mode::Substring);
+        addSearchMode("Fuzzy Search", EntrySearchModel::Mode::Fuzzy);
+        addSearchMode("Full-Text Search", EntrySearchModel::Mode::FullText);
+
+        viewMenu->addSeparator();
+        QAction* mostUsedAction = new QAction("Sort by Most Used", this);
+        mostUsedAction->setCheckable(true);
+        viewMenu->addAction(mostUsedAction);
+        connect(mostUsedAction, &QAction::toggled, searchModel, &EntrySearchModel::setSortByUsage);
+
+        QAction* typeOutAction = new QAction("Type Values Instead of Pasting", this);
+        typeOutAction->setCheckable(true);
+        viewMenu->addAction(typeOutAction);
+        connect(typeOutAction, &QAction::toggled, listView, &DraggableListView::setTypeOut);
+
+        fillMenu = menuBar()->addMenu("Fill");
+        rebuildFillMenu();
+        fillTimer = new QTimer(this);
+        fillTimer->setSingleShot(true);
+        fillTimer->setInterval(fillStartDelayMs);
+        connect(fillTimer, &QTimer::timeout, this, [this]() {
+            this->paster->requestFill(std::move(pendingFill), pendingFillDelayMs);
+            pendingFill.clear();
+        });
+        QShortcut* cancelShortcut = new QShortcut(QKeySequence(Qt::Key_Escape), this);
+        connect(cancelShortcut, &QShortcut::activated, this, &EasyInfoDropWindow::cancelFill);
+
         isKeysAndValuesView = true;
         connect(keysAndValuesAction, &QAction::triggered, this, &EasyInfoDropWindow::switchToKeysAndValues);
         connect(justValuesAction, &QAction::triggered, this, &EasyInfoDropWindow::switchToJustValues);
+
+        configPath = QString::fromStdString(std::filesystem::absolute(worker->path()).string());
+        watcher = new ConfigWatcher(QString::fromStdString(worker->path()), this);
+        connect(watcher, &ConfigWatcher::changed, this, [this]() { startReload(false); });
+        connect(worker, &PersistenceWorker::loaded, this, &EasyInfoDropWindow::finishReload);
+        connect(worker, &PersistenceWorker::usageLoaded, this, &EasyInfoDropWindow::finishUsageLoad);
+        connect(worker, &PersistenceWorker::sequencesLoaded, this, [this](FillSequencesPtr loaded) {
+            sequences = *loaded;
+            rebuildFillMenu();
+            if (entriesLoaded) {
+                blankRemovedFields();
+            }
+        });
+        connect(worker, &PersistenceWorker::compactionNeeded, this, [this]() {
+            this->worker->submitCompaction(model->store(), loadSerial);
+        });
+        connect(worker, &PersistenceWorker::compactionConflict, this, [this]() {
+            statusBar()->showMessage("config.json changed on disk; reloading it before compacting the journal", 5000);
+            startReload(false);
+        });
+        connect(worker, &PersistenceWorker::compacted, this, [this]() {
+            watcher->noteSelfWrite();
+        });
+        connect(worker, &PersistenceWorker::failed, this, [this](const QString& message) {
+            statusBar()->showMessage(message, 5000);
+        });
+        statusBar()->showMessage(QString("Loading config: %1").arg(configPath), 5000);
+        startReload(false);
+        worker->requestUsage();
+        worker->requestSequences();
+    }
+
+    ~EasyInfoDropWindow() override {
+        if (usageSaveTimer->isActive()) {
+            usageSaveTimer->stop();
+            saveUsage();
+        }
+        searchModel->setUsage(nullptr);
     }
 
 private slots:
-    void onItemClicked(QListWidgetItem* item) {
-        if (item) {
-            QString value = item->data(Qt::UserRole).toString();
-            statusBar()->showMessage(QString("Item clicked, copying value: %1").arg(value), 5000);
-            copyToClipboard(value);
+    void onItemClicked(const QModelIndex& index) {
+        if (index.isValid()) {
+            noteUse(index);
+            int row = model->store().rowOf(index.data(EntryListModel::IdRole).toULongLong());
+            if (row < 0) {
+                return;
+            }
+            SharedEntryText value = model->store().sharedValue(row);
+            statusBar()->showMessage(QString("Item clicked, copying value: %1").arg(EntryListModel::preview(value.view())), 5000);
+            copyToClipboard(this, value);
         } else {
             statusBar()->showMessage("No item provided to onItemClicked", 5000);
         }
@@ -232,20 +479,7 @@ private slots:
     }
 
     void refreshConfig() {
-        try {
-            std::ifstream config_file("config/config.json");
-            if (!config_file.is_open()) {
-                statusBar()->showMessage("Error: Could not open config/config.json for refresh", 5000);
-                return;
-            }
-            json config = json::parse(config_file);
-            config_file.close();
-            currentConfig = config.contains("items") && config["items"].is_array() ? config["items"] : json::array();
-            loadFields(currentConfig);
-            statusBar()->showMessage("Refreshed config from config/config.json", 5000);
-        } catch (const std::exception& e) {
-            statusBar()->showMessage(QString("Error refreshing config: %1").arg(e.what()), 5000);
-        }
+        startReload(true);
     }
 
     void addEntry() {
@@ -258,52 +492,116 @@ private slots:
                 return;
             }
 
-            try {
-                std::ifstream config_file("config/config.json");
-                if (!config_file.is_open()) {
-                    statusBar()->showMessage("Error: Could not open config/config.json for adding entry", 5000);
-                    return;
-                }
-                json config = json::parse(config_file);
-                config_file.close();
+            QStringList tags = dialog.getTags();
+            std::vector<std::string> tagList;
+            for (const QString& tag : tags) {
+                tagList.push_back(tag.toStdString());
+            }
+            EntryStore::EntryId id = model->appendEntry(name, value, tags);
+            worker->submitAdd(id, name.toStdString(), value.toStdString(), tagList);
+            ++configGeneration;
+            SharedEntryText stored = model->store().sharedValue(model->store().rowOf(id));
+            statusBar()->showMessage(QString("Added entry: %1 with value: %2").arg(name, EntryListModel::preview(stored.view())), 5000);
+        } else {
+            statusBar()->showMessage("Add entry cancelled", 5000);
+        }
+    }
 
-                if (!config.contains("items") || !config["items"].is_array()) {
-                    config["items"] = json::array();
+    void addSequence() {
+        AddSequenceDialog dialog(this);
+        if (dialog.exec() != QDialog::Accepted) {
+            statusBar()->showMessage("Add sequence cancelled", 5000);
+            return;
+        }
+        FillSequence sequence;
+        sequence.name = dialog.getName().toStdString();
+        sequence.fieldDelayMs = dialog.getFieldDelay();
+        const EntryStore& store = model->store();
+        for (const QString& name : dialog.getEntryNames()) {
+            int found = -1;
+            for (int row = 0; row < store.size() && found < 0; ++row) {
+                if (store.name(row).toString() == name) {
+                    found = row;
                 }
-                config["items"].push_back({{"name", name.toStdString()}, {"value", value.toStdString()}});
+            }
+            if (found < 0) {
+                statusBar()->showMessage(QString("Add sequence cancelled: no entry named %1").arg(name), 5000);
+                return;
+            }
+            sequence.entries.push_back(store.idAt(found));
+        }
+        if (sequence.name.empty() || sequence.entries.empty()) {
+            statusBar()->showMessage("Add sequence cancelled or name/entries empty", 5000);
+            return;
+        }
+        sequences.push_back(std::move(sequence));
+        worker->submitSequences(sequences);
+        rebuildFillMenu();
+        statusBar()->showMessage(QString("Added sequence: %1").arg(dialog.getName()), 5000);
+    }
 
-                std::ofstream out_file("config/config.json");
-                if (!out_file.is_open()) {
-                    statusBar()->showMessage("Error: Could not open config/config.json for writing", 5000);
-                    return;
-                }
-                out_file << config.dump(2);
-                out_file.close();
-
-                currentConfig = config["items"];
-                loadFields(currentConfig);
-                statusBar()->showMessage(QString("Added entry: %1 with value: %2").arg(name, value), 5000);
-            } catch (const std::exception& e) {
-                statusBar()->showMessage(QString("Error adding entry: %1").arg(e.what()), 5000);
+    // Gives the user fillStartDelayMs to click into the form's first field
+    // before typing starts.
+    void startFill(std::size_t index) {
+        if (index >= sequences.size()) {
+            return;
+        }
+        const FillSequence& sequence = sequences[index];
+        QString name = QString::fromStdString(sequence.name);
+        std::vector<SharedEntryText> fields;
+        QStringList missing;
+        bool anyEntry = false;
+        for (std::size_t field = 0; field < sequence.entries.size(); ++field) {
+            EntryStore::EntryId id = sequence.entries[field];
+            if (id == FillSequence::blankField) {
+                fields.emplace_back();
+                continue;
             }
-        } else {
-            statusBar()->showMessage("Add entry cancelled", 5000);
+            int row = model->store().rowOf(id);
+            if (row < 0) {
+                missing.append(QString::number(field + 1));
+                continue;
+            }
+            fields.push_back(model->store().sharedValue(row));
+            anyEntry = true;
+        }
+        // Typing the rest would shift every later value into the wrong field.
+        if (!missing.isEmpty()) {
+            statusBar()->showMessage(QString("Sequence %1 not filled: the entries of field(s) %2 are missing")
+                .arg(name, missing.join(", ")), 5000);
+            return;
+        }
+        if (!anyEntry) {
+            statusBar()->showMessage(QString("Sequence %1 has no entries left").arg(name), 5000);
+            return;
         }
+        pendingFill = std::move(fields);
+        pendingFillDelayMs = sequence.fieldDelayMs;
+        fillTimer->start();
+        statusBar()->showMessage(QString("Filling %1 field(s) in %2 s: click into the first one. Esc cancels.")
+            .arg(pendingFill.size()).arg(fillStartDelayMs / 1000), fillStartDelayMs);
+    }
+
+    void cancelFill() {
+        if (fillTimer->isActive()) {
+            fillTimer->stop();
+            pendingFill.clear();
+            statusBar()->showMessage("Form fill cancelled", 5000);
+        }
+        paster->cancel();
     }
 
     void deleteEntry() {
-        QListWidgetItem* item = listWidget->currentItem();
-        if (!item) {
+        QModelIndex index = listView->currentIndex();
+        if (!index.isValid()) {
             statusBar()->showMessage("No item selected for deletion", 5000);
             return;
         }
 
-        QString name = item->text().split(" > ").first();
-        if (isKeysAndValuesView) {
-            name = item->text().split(" > ").first();
-        } else {
-            name = item->data(Qt::UserRole + 1).toString(); // Store name in UserRole + 1
-        }
+        // The dialog below runs an event loop in which a reload may move
+        // rows, so the entry is tracked by ID rather than by row.
+        EntryStore::EntryId id = index.data(EntryListModel::IdRole).toULongLong();
+        QString name = index.data(EntryListModel::NameRole).toString();
         QMessageBox::StandardButton reply = QMessageBox::question(
             this,
             "Confirm Deletion",
@@ -316,159 +614,261 @@ private slots:
             return;
         }
 
-        try {
-            std::ifstream config_file("config/config.json");
-            if (!config_file.is_open()) {
-                statusBar()->showMessage("Error: Could not open config/config.json for deleting entry", 5000);
-                return;
-            }
-            json config = json::parse(config_file);
-            config_file.close();
-
-            if (config.contains("items") && config["items"].is_array()) {
-                auto& items = config["items"];
-                for (auto it = items.begin(); it != items.end(); ++it) {
-                    if ((*it)["name"].get<std::string>() == name.toStdString()) {
-                        items.erase(it);
-                        break;
-                    }
-                }
-            }
-
-            std::ofstream out_file("config/config.json");
-            if (!out_file.is_open()) {
-                statusBar()->showMessage("Error: Could not open config/config.json for writing", 5000);
-                return;
-            }
-            out_file << config.dump(2);
-            out_file.close();
-
-            currentConfig = config.contains("items") && config["items"].is_array() ? config["items"] : json::array();
-            loadFields(currentConfig);
+        int row = model->store().rowOf(id);
+        if (row < 0) {
+            statusBar()->showMessage(QString("Entry %1 was already removed").arg(name), 5000);
+            return;
+        }
+        model->removeEntry(row);
+        worker->submitDelete(id);
+        pruneUsage();
+        ++configGeneration;
+        QStringList blanked = pruneSequences();
+        if (blanked.isEmpty()) {
             statusBar()->showMessage(QString("Deleted entry: %1").arg(name), 5000);
-        } catch (const std::exception& e) {
-            statusBar()->showMessage(QString("Error deleting entry: %1").arg(e.what()), 5000);
+        } else {
+            statusBar()->showMessage(QString("Deleted entry: %1; its field is now blank in sequence(s) %2")
+                .arg(name, blanked.join(", ")), 5000);
         }
     }
 
     void switchToKeysAndValues() {
         isKeysAndValuesView = true;
-        loadFields(currentConfig);
+        model->setShowKeys(true);
         statusBar()->showMessage("Switched to Keys and Values view", 5000);
     }
 
     void switchToJustValues() {
         isKeysAndValuesView = false;
-        loadFields(currentConfig);
+        model->setShowKeys(false);
         statusBar()->showMessage("Switched to Just Values view", 5000);
     }
 
 private:
-    void loadFields(const json& fields) {
-        listWidget->clear();
-        if (!fields.is_array()) {
-            statusBar()->showMessage("Error: Config items is not an array", 5000);
-            return;
+    static constexpr int completionLimit = 12;
+    static constexpr int usageSaveDelayMs = 10000;
+    static constexpr int fillStartDelayMs = 3000;
+
+    void rebuildFillMenu() {
+        fillMenu->clear();
+        QAction* addAction = fillMenu->addAction("Add Sequence...");
+        connect(addAction, &QAction::triggered, this, &EasyInfoDropWindow::addSequence);
+        if (!sequences.empty()) {
+            fillMenu->addSeparator();
         }
-        for (const auto& field : fields) {
-            if (!field.is_object() || !field.contains("name") || !field.contains("value")) {
-                statusBar()->showMessage("Error: Invalid item format in config", 5000);
-                continue;
+        for (std::size_t i = 0; i < sequences.size(); ++i) {
+            QAction* action = fillMenu->addAction(QString::fromStdString(sequences[i].name));
+            connect(action, &QAction::triggered, this, [this, i]() { startFill(i); });
+        }
+    }
+
+    // Uses are counted in memory and written out at most every
+    // usageSaveDelayMs, all together, and on exit.
+    void noteUse(const QModelIndex& index) {
+        usage.record(index.data(EntryListModel::IdRole).toULongLong(), UsageIndex::currentTime());
+        scheduleUsageSave();
+    }
+
+    void forgetUsage(EntryStore::EntryId id) {
+        if (usage.uses(id) > 0) {
+            usage.remove(id);
+            scheduleUsageSave();
+        }
+    }
+
+    // Drops the usage of entries the config no longer has. Called once a
+    // change is complete, since a diff moves an entry by removing and
+    // reinserting it under the same ID.
+    void pruneUsage() {
+        std::vector<EntryStore::EntryId> gone;
+        for (const UsageIndex::Record& record : usage.records()) {
+            if (model->store().rowOf(record.id) < 0) {
+                gone.push_back(record.id);
+            }
+        }
+        for (EntryStore::EntryId id : gone) {
+            forgetUsage(id);
+        }
+    }
+
+    // Turns the fields of entries the config no longer has into blank ones
+    // and saves the sequences if any changed, so config.sequences never
+    // refers to a deleted entry. Returns the names of the sequences changed.
+    QStringList pruneSequences() {
+        QStringList changed;
+        for (FillSequence& sequence : sequences) {
+            bool blanked = false;
+            for (EntryStore::EntryId& id : sequence.entries) {
+                if (id != FillSequence::blankField && model->store().rowOf(id) < 0) {
+                    id = FillSequence::blankField;
+                    blanked = true;
+                }
             }
-            QString name = QString::fromStdString(field["name"].get<std::string>());
-            QString value = QString::fromStdString(field["value"].get<std::string>());
-            QString displayValue;
-            if (value.length() > 18) {
-                int len = value.length();
-                int midStart = len / 2 - 3;
-                displayValue = value.left(6) + ".." + value.mid(midStart, 6) + ".." + value.right(6);
-            } else {
-                displayValue = value;
+            if (blanked) {
+                changed.append(QString::fromStdString(sequence.name));
             }
-            QString displayText = isKeysAndValuesView ? QString("%1 > %2").arg(name, displayValue) : displayValue;
-            QListWidgetItem* item = new QListWidgetItem(displayText, listWidget);
-            item->setData(Qt::UserRole, value);
-            item->setData(Qt::UserRole + 1, name); // Store name for deletion in Just Values mode
-            item->setToolTip(value);
-            statusBar()->showMessage(QString("Added item: %1 with value: %2").arg(name, value), 5000);
+        }
+        if (!changed.isEmpty()) {
+            worker->submitSequences(sequences);
+        }
+        return changed;
+    }
+
+    void blankRemovedFields() {
+        QStringList blanked = pruneSequences();
+        if (!blanked.isEmpty()) {
+            statusBar()->showMessage(QString("Entries gone from the config are now blank fields in sequence(s) %1")
+                .arg(blanked.join(", ")), 5000);
+        }
+    }
+
+    void scheduleUsageSave() {
+        if (!usageSaveTimer->isActive()) {
+            usageSaveTimer->start();
+        }
+    }
+
+    void saveUsage() {
+        worker->submitUsage(usage.records());
+    }
+
+    // Counters saved by earlier sessions join the ones recorded since
+    // startup.
+    void finishUsageLoad(UsageRecordsPtr records) {
+        for (const UsageIndex::Record& record : *records) {
+            usage.merge(record);
+        }
+        if (entriesLoaded) {
+            pruneUsage();
+        }
+        searchModel->applyUsage();
+    }
+
+    // Offers the names starting with the search text.
+    void updateCompletions(const QString& text) {
+        QStringList list = text.isEmpty() ? QStringList() : names->complete(text, completionLimit);
+        completions->setStringList(list);
+        if (!list.isEmpty()) {
+            searchEdit->completer()->complete();
         }
     }
 
-    void copyToClipboard(const QString& value) {
-        QClipboard* clipboard = QApplication::clipboard();
-        if (clipboard) {
-            clipboard->setText(value);
-            statusBar()->showMessage(QString("Copied to clipboard: %1").arg(value), 5000);
+    // Loads run on the persistence worker. Mutations are applied to the
+    // model before they reach disk, so a load that was requested before the
+    // latest mutation is stale and is requested again.
+    void startReload(bool manual) {
+        if (reloadRunning) {
+            reloadQueued = true;
+            reloadManual = reloadManual || manual;
+            return;
+        }
+        reloadRunning = true;
+        reloadManual = manual;
+        worker->requestLoad(configGeneration);
+    }
+
+    void finishReload(LoadedConfigPtr result, quint64 generation) {
+        bool manual = reloadManual;
+        bool initial = !initialLoadDone;
+        reloadRunning = false;
+        reloadManual = false;
+        if (generation != configGeneration) {
+            reloadQueued = true;
+            reloadManual = manual;
+        } else if (!result->ok) {
+            initialLoadDone = true;
+            statusBar()->showMessage(QString("Error parsing config at %1: %2").arg(configPath, QString::fromStdString(result->error)), 5000);
         } else {
-            statusBar()->showMessage("Failed to get clipboard", 5000);
+            initialLoadDone = true;
+            entriesLoaded = true;
+            loadSerial = result->loadSerial;
+            EntryDiff diff = diffEntries(model->store(), result->entries);
+            model->applyDiff(result->entries, diff);
+            pruneUsage();
+            if (!result->recovered.empty()) {
+                statusBar()->showMessage(QString("Recovered config: %1").arg(QString::fromStdString(result->recovered)), 5000);
+            } else if (!result->issues.empty()) {
+                const ConfigIssue& issue = result->issues.front();
+                statusBar()->showMessage(QString("Skipped %1 malformed item(s) in config; first at byte %2: %3")
+                    .arg(result->issues.size()).arg(issue.offset).arg(QString::fromStdString(issue.message)), 5000);
+            } else if (initial && result->fromSnapshot) {
+                statusBar()->showMessage(QString("Config loaded from snapshot cache: %1").arg(configPath), 5000);
+            } else if (initial) {
+                statusBar()->showMessage(QString("Config loaded: %1").arg(configPath), 5000);
+            } else if (diff.reset) {
+                statusBar()->showMessage("Refreshed config from config/config.json", 5000);
+            } else if (manual || !diff.edits.empty()) {
+                statusBar()->showMessage(QString("Refreshed config from config/config.json (%1 changes)").arg(diff.edits.size()), 5000);
+            }
+            blankRemovedFields();
+            if (initial && result->created) {
+                watcher->noteSelfWrite();
+            }
+        }
+        if (reloadQueued) {
+            reloadQueued = false;
+            startReload(reloadManual);
         }
     }
 
-    DraggableListWidget* listWidget;
+    DraggableListView* listView;
+    QLineEdit* searchEdit;
+    QLineEdit* tagFilterEdit;
+    EntryListModel* model;
+    EntrySearchModel* searchModel;
+    NameIndex* names;
+    QStringListModel* completions;
+    UsageIndex usage;
+    QTimer* usageSaveTimer;
     QPushButton* pinButton;
     QPushButton* refreshButton;
     QPushButton* addButton;
     QPushButton* deleteButton;
     bool isSticky = false;
     bool isKeysAndValuesView;
-    json currentConfig;
+    PersistenceWorker* worker;
+    PasteEngine* paster;
+    QMenu* fillMenu;
+    QTimer* fillTimer;
+    std::vector<FillSequence> sequences;
+    std::vector<SharedEntryText> pendingFill; // Values of the fill waiting for fillTimer
+    int pendingFillDelayMs = 0;
+    ConfigWatcher* watcher;
+    QString configPath;
+    bool initialLoadDone = false;
+    std::uint64_t loadSerial = 0; // Of the load the model reflects
+    bool entriesLoaded = false; // Whether a config has loaded, so usage can be pruned
+    bool reloadRunning = false;
+    bool reloadQueued = false;
+    bool reloadManual = false;
+    quint64 configGeneration = 0;
 };
 
 #include "main.moc"
 
 int main(int argc, char* argv[]) {
     QApplication app(argc, argv);
-    json config;
-    QString configPath = QString::fromStdString(std::filesystem::absolute("config/config.json").string());
-    try {
-        std::filesystem::create_directories("config");
-        std::ifstream config_file("config/config.json");
-        if (!config_file.is_open()) {
-            config = {
-                {"items", {
-                    {{"name", "Full Name"}, {"value", "Joooooooooohn Dooooooooooe"}},
-                    {{"name", "Email"}, {"value", "john@example.com"}},
-                    {{"name", "Name"}, {"value", "John"}},
-                    {{"name", "Last Name"}, {"value", "Doe"}}
-                }}
-            };
-            std::ofstream out_file("config/config.json");
-            if (!out_file.is_open()) {
-                EasyInfoDropWindow window(config);
-                window.statusBar()->showMessage(QString("Error: Could not create config/config.json at: %1").arg(configPath), 5000);
-                window.show();
-                return app.exec();
-            }
-            out_file << config.dump(2);
-            out_file.close();
-            EasyInfoDropWindow window(config);
-            window.statusBar()->showMessage(QString("Config loaded: %1").arg(configPath), 5000);
-            window.show();
-            return app.exec();
-        } else {
-            config = json::parse(config_file);
-            config_file.close();
-            if (!config.is_object()) {
-                config = json::object();
-            }
-            if (!config.contains("items") || !config["items"].is_array()) {
-                config["items"] = json::array();
-            }
-            EasyInfoDropWindow window(config);
-            window.statusBar()->showMessage(QString("Config loaded: %1").arg(configPath), 5000);
-            window.show();
-            return app.exec();
-        }
-    } catch (const std::exception& e) {
-        if (!config.is_object()) {
-            config = json::object();
-        }
-        if (!config.contains("items") || !config["items"].is_array()) {
-            config["items"] = json::array();
-        }
-        EasyInfoDropWindow window(config);
-        window.statusBar()->showMessage(QString("Error parsing config at %1: %2").arg(configPath, e.what()), 5000);
+    QThread ioThread;
+    PersistenceWorker worker("config/config.json");
+    worker.moveToThread(&ioThread);
+    ioThread.start();
+    QThread pasteThread;
+    PasteEngine paster;
+    paster.moveToThread(&pasteThread);
+    pasteThread.start();
+
+    int result;
+    {
+        EasyInfoDropWindow window(&worker, &paster);
         window.show();
-        return app.exec();
+        result = app.exec();
     }
+
+    pasteThread.quit();
+    pasteThread.wait();
+    ioThread.quit();
+    ioThread.wait();
+    // Jobs posted after the worker's event loop stopped are still queued.
+    worker.finish();
+    return result;
 }
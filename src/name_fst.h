@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Immutable map from byte-string keys (UTF-8 entry names) to entry IDs,
+// stored as a minimal acyclic automaton: keys sharing a prefix share the
+// states for it, and keys sharing a suffix share those states too, so a
+// library of "addr-home", "addr-work", ... costs little more than its
+// distinct characters.
+//
+// Every state also counts the keys below it. Walking a prefix therefore
+// yields the ordinal range of the keys that start with it in sorted order,
+// without visiting them, and the IDs of key ordinal k are
+// ids[idStart[k], idStart[k + 1]).
+class NameFst {
+public:
+    using EntryId = std::uint64_t;
+
+    // Keys [first, last) in sorted order, all below state.
+    struct Range {
+        std::size_t first = 0;
+        std::size_t last = 0;
+        std::uint32_t state = 0;
+
+        bool isEmpty() const { return first == last; }
+    };
+
+    // Builds the automaton for any list of (key, id) pairs; a key may come
+    // with several IDs.
+    static NameFst build(std::vector<std::pair<std::string, EntryId>> entries) {
+        std::sort(entries.begin(), entries.end());
+        NameFst fst;
+        Builder builder(fst);
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (i == 0 || entries[i].first != entries[i - 1].first) {
+                builder.add(entries[i].first);
+                fst.idStart.push_back(static_cast<std::uint32_t>(fst.ids.size()));
+            }
+            fst.ids.push_back(entries[i].second);
+        }
+        fst.idStart.push_back(static_cast<std::uint32_t>(fst.ids.size()));
+        fst.root = builder.finish();
+        fst.firstArc.push_back(static_cast<std::uint32_t>(fst.labels.size()));
+        return fst;
+    }
+
+    std::size_t keyCount() const { return idStart.empty() ? 0 : idStart.size() - 1; }
+    std::size_t stateCount() const { return words.size(); }
+
+    std::size_t memoryUsage() const {
+        return labels.size() + targets.size() * sizeof(std::uint32_t) + firstArc.size() * sizeof(std::uint32_t)
+            + words.size() * sizeof(std::uint32_t) + finals.size() + idStart.size() * sizeof(std::uint32_t)
+            + ids.size() * sizeof(EntryId);
+    }
+
+    Range prefixRange(std::string_view prefix) const {
+        if (words.empty()) {
+            return {};
+        }
+        std::uint32_t state = root;
+        std::size_t ordinal = 0;
+        for (char c : prefix) {
+            const unsigned char label = static_cast<unsigned char>(c);
+            ordinal += finals[state];
+            std::uint32_t arc = firstArc[state];
+            const std::uint32_t end = firstArc[state + 1];
+            for (; arc < end && labels[arc] < label; ++arc) {
+                ordinal += words[targets[arc]];
+            }
+            if (arc == end || labels[arc] != label) {
+                return {};
+            }
+            state = targets[arc];
+        }
+        return {ordinal, ordinal + words[state], state};
+    }
+
+    // Number of IDs under keys starting with prefix, without listing them.
+    std::size_t countWithPrefix(std::string_view prefix) const {
+        Range range = prefixRange(prefix);
+        return range.isEmpty() ? 0 : idStart[range.last] - idStart[range.first];
+    }
+
+    // IDs of every key starting with prefix, grouped by key in key order.
+    std::vector<EntryId> idsWithPrefix(std::string_view prefix) const {
+        Range range = prefixRange(prefix);
+        if (range.isEmpty()) {
+            return {};
+        }
+        return std::vector<EntryId>(ids.begin() + idStart[range.first], ids.begin() + idStart[range.last]);
+    }
+
+    // Calls f(key, firstId, lastId) for the first limit keys starting with
+    // prefix, in key order.
+    template <typename F>
+    void complete(std::string_view prefix, std::size_t limit, F&& f) const {
+        Range range = prefixRange(prefix);
+        if (range.isEmpty() || limit == 0) {
+            return;
+        }
+        struct Frame {
+            std::uint32_t arc;
+            std::uint32_t end;
+        };
+        std::vector<Frame> stack;
+        std::string key(prefix);
+        std::size_t ordinal = range.first;
+        std::size_t emitted = 0;
+        auto enter = [&](std::uint32_t state) {
+            if (finals[state]) {
+                f(static_cast<const std::string&>(key), ids.data() + idStart[ordinal], ids.data() + idStart[ordinal + 1]);
+                ++ordinal;
+                if (++emitted == limit) {
+                    return false;
+                }
+            }
+            stack.push_back({firstArc[state], firstArc[state + 1]});
+            return true;
+        };
+        if (!enter(range.state)) {
+            return;
+        }
+        while (!stack.empty()) {
+            Frame& top = stack.back();
+            if (top.arc == top.end) {
+                stack.pop_back();
+                if (!stack.empty()) {
+                    key.pop_back();
+                }
+                continue;
+            }
+            std::uint32_t arc = top.arc++;
+            key.push_back(static_cast<char>(labels[arc]));
+            if (!enter(targets[arc])) {
+                return;
+            }
+        }
+    }
+
+private:
+    // Incremental construction from sorted, distinct keys (Daciuk et al.):
+    // only the path of the last key is mutable, and the part of it the next
+    // key does not share is frozen, replacing each state with an equal one
+    // already built when there is one.
+    class Builder {
+    public:
+        explicit Builder(NameFst& fst) : fst(fst), path(1) {}
+
+        void add(const std::string& key) {
+            std::size_t common = 0;
+            while (common < previous.size() && common < key.size() && previous[common] == key[common]) {
+                ++common;
+            }
+            freeze(common);
+            for (std::size_t i = common; i < key.size(); ++i) {
+                path.back().arcs.emplace_back(static_cast<unsigned char>(key[i]), 0);
+                path.emplace_back();
+            }
+            path.back().final = true;
+            previous = key;
+        }
+
+        std::uint32_t finish() {
+            freeze(0);
+            return intern(path.front());
+        }
+
+    private:
+        struct Node {
+            bool final = false;
+            std::vector<std::pair<unsigned char, std::uint32_t>> arcs;
+        };
+
+        void freeze(std::size_t depth) {
+            while (path.size() > depth + 1) {
+                std::uint32_t state = intern(path.back());
+                path.pop_back();
+                path.back().arcs.back().second = state;
+            }
+        }
+
+        std::uint32_t intern(const Node& node) {
+            signature.assign(1, node.final ? '\1' : '\0');
+            for (const auto& arc : node.arcs) {
+                signature.push_back(static_cast<char>(arc.first));
+                signature.append(reinterpret_cast<const char*>(&arc.second), sizeof(arc.second));
+            }
+            auto found = registry.find(signature);
+            if (found != registry.end()) {
+                return found->second;
+            }
+            std::uint32_t state = static_cast<std::uint32_t>(fst.words.size());
+            std::uint32_t count = node.final ? 1 : 0;
+            fst.firstArc.push_back(static_cast<std::uint32_t>(fst.labels.size()));
+            for (const auto& arc : node.arcs) {
+                fst.labels.push_back(arc.first);
+                fst.targets.push_back(arc.second);
+                count += fst.words[arc.second];
+            }
+            fst.words.push_back(count);
+            fst.finals.push_back(node.final ? 1 : 0);
+            registry.emplace(signature, state);
+            return state;
+        }
+
+        NameFst& fst;
+        std::vector<Node> path; // Mutable states along the last key
+        std::string previous;
+        std::string signature;
+        std::unordered_map<std::string, std::uint32_t> registry;
+    };
+
+    // Arcs of state s are [firstArc[s], firstArc[s + 1]), sorted by label.
+    std::vector<unsigned char> labels;
+    std::vector<std::uint32_t> targets;
+    std::vector<std::uint32_t> firstArc;
+    std::vector<std::uint32_t> words; // Keys accepted from each state
+    std::vector<std::uint8_t> finals;
+    std::vector<std::uint32_t> idStart;
+    std::vector<EntryId> ids;
+    std::uint32_t root = 0;
+};
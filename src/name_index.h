@@ -0,0 +1,122 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "entry_list_model.h"
+#include "name_fst.h"
+#include "search_key.h"
+
+// Entry names of an EntryListModel as a NameFst, for prefix lookups and
+// autocomplete. Keys are SearchKeys, so lookups ignore case and accents.
+//
+// The automaton is rebuilt on a thread of its own, rebuildDelayMs after the
+// model last changed, from a copy of the store. Lookups keep using the
+// previous automaton until the new one is swapped in, so they never wait
+// for a build; IDs it returns may name entries removed since, which the
+// callers check against the store. Callers that need every entry use
+// currentAutomaton(), which is null while the automaton lags the model.
+class NameIndex : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int rebuildDelayMs = 200;
+
+    explicit NameIndex(EntryListModel* entries, QObject* parent = nullptr)
+        : QObject(parent), entries(entries), fst(std::make_shared<NameFst>()) {
+        builder.moveToThread(&buildThread);
+        buildThread.start();
+        rebuildTimer.setSingleShot(true);
+        rebuildTimer.setInterval(rebuildDelayMs);
+        connect(&rebuildTimer, &QTimer::timeout, this, &NameIndex::rebuild);
+        auto changed = [this]() { rebuildTimer.start(); };
+        connect(entries, &QAbstractItemModel::modelReset, this, changed);
+        connect(entries, &QAbstractItemModel::rowsInserted, this, changed);
+        connect(entries, &QAbstractItemModel::rowsRemoved, this, changed);
+        connect(entries, &QAbstractItemModel::dataChanged, this, changed);
+        rebuild();
+    }
+
+    ~NameIndex() override {
+        buildThread.quit();
+        buildThread.wait();
+    }
+
+    // Entries whose name starts with prefix, grouped by name.
+    std::vector<EntryStore::EntryId> idsWithPrefix(const QString& prefix) const {
+        return fst->idsWithPrefix(SearchKey::fold(prefix));
+    }
+
+    // Up to limit names starting with prefix, in order, spelled as in the
+    // store.
+    QStringList complete(const QString& prefix, int limit) const {
+        QStringList names;
+        const EntryStore& store = entries->store();
+        fst->complete(SearchKey::fold(prefix), static_cast<std::size_t>(limit),
+                      [&](const std::string&, const EntryStore::EntryId* first, const EntryStore::EntryId* last) {
+            for (const EntryStore::EntryId* id = first; id != last; ++id) {
+                int row = store.rowOf(*id);
+                if (row >= 0) {
+                    names.append(store.name(row).toString());
+                    return;
+                }
+            }
+        });
+        return names;
+    }
+
+    // The automaton if it was built from the model's current entries.
+    std::shared_ptr<const NameFst> currentAutomaton() const {
+        return builtRevision == entries->revision() ? fst : nullptr;
+    }
+
+signals:
+    void rebuilt();
+
+private:
+    void rebuild() {
+        if (building) {
+            rebuildQueued = true;
+            return;
+        }
+        building = true;
+        // Copying the store shares its text; the keys are made on the
+        // build thread.
+        QMetaObject::invokeMethod(&builder, [this, snapshot = entries->store(), revision = entries->revision()]() {
+            std::vector<std::pair<std::string, EntryStore::EntryId>> names;
+            names.reserve(static_cast<std::size_t>(snapshot.size()));
+            for (int row = 0; row < snapshot.size(); ++row) {
+                names.emplace_back(SearchKey::fold(snapshot.name(row)), snapshot.idAt(row));
+            }
+            auto built = std::make_shared<NameFst>(NameFst::build(std::move(names)));
+            QMetaObject::invokeMethod(this, [this, built, revision]() { finishRebuild(built, revision); },
+                                      Qt::QueuedConnection);
+        }, Qt::QueuedConnection);
+    }
+
+    void finishRebuild(std::shared_ptr<const NameFst> built, std::uint64_t revision) {
+        fst = std::move(built);
+        builtRevision = revision;
+        building = false;
+        emit rebuilt();
+        if (rebuildQueued) {
+            rebuildQueued = false;
+            rebuild();
+        }
+    }
+
+    EntryListModel* entries;
+    std::shared_ptr<const NameFst> fst; // UI thread only
+    std::uint64_t builtRevision = UINT64_MAX; // Model revision fst was built from
+    QThread buildThread;
+    QObject builder; // Lives on buildThread
+    QTimer rebuildTimer;
+    bool building = false;
+    bool rebuildQueued = false;
+};
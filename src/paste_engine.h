@@ -0,0 +1,444 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "entry_store.h"
+#ifdef __linux__
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+#endif
+
+// Injects keystrokes into whichever window has the keyboard focus, on the
+// thread it is moved to. request*() may be called from any thread; they
+// append to a FIFO command queue that the engine drains in order.
+//
+// One X connection is opened on first use and kept, along with the
+// keycodes it needs, so a paste costs four XTest key events and a flush
+// rather than a connection round trip. XTest events go through the server
+// like real key presses, unlike XSendEvent, which many clients ignore. If
+// the connection cannot be opened (no X server, no XTest) the command
+// fails and the next one tries again.
+//
+// Typing a value instead, for targets that block pasting, sends a key
+// press and release per character. Characters the keyboard map has no key
+// for are typed on spare keycodes (ones with no keysyms): the next batch
+// of such characters, up to one per spare key, is mapped with one request
+// each and a single XSync, and the keys are cleared again afterwards.
+// Keys go out in chunks with an XSync after each; a quick sync doubles
+// the chunk and a slow one, meaning the server is falling behind, halves
+// it and waits as long as the sync took, so typing runs as fast as the
+// target keeps up.
+//
+// A form fill types several values with Tab between them, as one command,
+// pausing after each Tab for forms that are slow to move the focus. Typing
+// stops at the next chunk or pause once cancel() is called or while Esc
+// is held down.
+class PasteEngine : public QObject {
+    Q_OBJECT
+public:
+    explicit PasteEngine(QObject* parent = nullptr) : QObject(parent) {}
+
+    ~PasteEngine() override { closeDisplay(); }
+
+    // Ctrl+V into the focused window; reported by pasted() or failed().
+    void requestPaste() {
+        Command command;
+        command.kind = Command::Paste;
+        enqueue(command);
+    }
+
+    // Types text into the focused window as key presses; reported by
+    // typed() or failed(). The text is read from the store's block, not
+    // copied.
+    void requestType(SharedEntryText text) {
+        Command command;
+        command.kind = Command::Type;
+        command.fields.push_back(std::move(text));
+        enqueue(std::move(command));
+    }
+
+    // Fills a form: types each field's value, pressing Tab between them
+    // and pausing fieldDelayMs after each Tab; reported by filled() or
+    // failed().
+    void requestFill(std::vector<SharedEntryText> fields, int fieldDelayMs) {
+        Command command;
+        command.kind = Command::Fill;
+        command.fields = std::move(fields);
+        command.fieldDelayMs = fieldDelayMs;
+        enqueue(std::move(command));
+    }
+
+    // Drops every command queued so far and stops the one running at its
+    // next chunk. Holding Esc while typing does the same for that command.
+    void cancel() { ++generation; }
+
+signals:
+    // latencyUs runs from the request to the XFlush that sent the keys.
+    void pasted(qint64 latencyUs);
+    void typed(int characters, qint64 elapsedUs);
+    void filled(int fields, int characters, qint64 elapsedUs);
+    void failed(QString message);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Command {
+        enum Kind { Paste, Type, Fill };
+        Kind kind = Paste;
+        std::vector<SharedEntryText> fields; // One for Type
+        int fieldDelayMs = 0;
+        int generation = 0; // Of cancel() when queued
+        Clock::time_point requested = Clock::now();
+    };
+
+    void enqueue(Command command) {
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            command.generation = generation.load();
+            queue.push_back(std::move(command));
+            schedule = !drainScheduled;
+            drainScheduled = true;
+        }
+        if (schedule) {
+            QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+        }
+    }
+
+    void drain() {
+        std::deque<Command> commands;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            commands.swap(queue);
+            drainScheduled = false;
+        }
+        for (const Command& command : commands) {
+            if (command.generation != generation.load()) {
+                continue;
+            }
+            if (command.kind != Command::Paste) {
+                type(command);
+            } else {
+                paste(command);
+            }
+        }
+    }
+
+#ifdef __linux__
+    bool openDisplay() {
+        if (display) {
+            return true;
+        }
+        display = XOpenDisplay(nullptr);
+        if (!display) {
+            emit failed("Error: Cannot open X display.");
+            return false;
+        }
+        int eventBase = 0;
+        int errorBase = 0;
+        int major = 0;
+        int minor = 0;
+        if (!XTestQueryExtension(display, &eventBase, &errorBase, &major, &minor)) {
+            closeDisplay();
+            emit failed("Error: The X server does not support XTest.");
+            return false;
+        }
+        controlKey = XKeysymToKeycode(display, XK_Control_L);
+        shiftKey = XKeysymToKeycode(display, XK_Shift_L);
+        vKey = XKeysymToKeycode(display, XK_v);
+        escapeKey = XKeysymToKeycode(display, XK_Escape);
+        tabKey = XKeysymToKeycode(display, XK_Tab);
+        return true;
+    }
+
+    void closeDisplay() {
+        if (display) {
+            XCloseDisplay(display);
+            display = nullptr;
+        }
+    }
+
+    void paste(const Command& command) {
+        if (!openDisplay()) {
+            return;
+        }
+        XTestFakeKeyEvent(display, controlKey, True, CurrentTime);
+        XTestFakeKeyEvent(display, vKey, True, CurrentTime);
+        XTestFakeKeyEvent(display, vKey, False, CurrentTime);
+        XTestFakeKeyEvent(display, controlKey, False, CurrentTime);
+        XFlush(display);
+        emit pasted(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - command.requested).count());
+    }
+
+    static constexpr int minChunk = 8;
+    static constexpr int maxChunk = 512;
+    static constexpr std::int64_t slowSyncUs = 2000; // A sync slower than this backs off
+    static constexpr int mappingSettleMs = 5; // Lets clients see a remap before its keys
+    static constexpr std::size_t maxSpareKeys = 32;
+    static constexpr int cancelPollMs = 20;
+
+    struct KeyStroke {
+        KeyCode code = 0;
+        bool shift = false;
+    };
+
+    // The keysym that types c, or NoSymbol for characters that cannot be
+    // typed, such as other control characters.
+    static KeySym keysymFor(char32_t c) {
+        if (c == U'\n' || c == U'\r') {
+            return XK_Return;
+        }
+        if (c == U'\t') {
+            return XK_Tab;
+        }
+        if (c < 0x20 || (c >= 0x7F && c < 0xA0)) {
+            return NoSymbol;
+        }
+        return c < 0x100 ? static_cast<KeySym>(c) : static_cast<KeySym>(0x01000000 | c);
+    }
+
+    static std::vector<KeySym> keysymsOf(EntryText text) {
+        std::vector<KeySym> syms;
+        syms.reserve(static_cast<std::size_t>(text.length));
+        for (int i = 0; i < text.length; ++i) {
+            char32_t c = text.data[i];
+            if (c >= 0xD800 && c < 0xDC00 && i + 1 < text.length && text.data[i + 1] >= 0xDC00 && text.data[i + 1] < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (text.data[i + 1] - 0xDC00);
+                ++i;
+            }
+            syms.push_back(keysymFor(c));
+        }
+        return syms;
+    }
+
+    // Reads the keyboard map once per typed value, so a layout switch
+    // between values is picked up: which key and shift level types each
+    // keysym, unshifted preferred, and which keycodes are free.
+    void loadKeymap() {
+        keymap.clear();
+        spareKeys.clear();
+        int minCode = 0;
+        int maxCode = 0;
+        XDisplayKeycodes(display, &minCode, &maxCode);
+        int perCode = 0;
+        KeySym* map = XGetKeyboardMapping(display, static_cast<KeyCode>(minCode), maxCode - minCode + 1, &perCode);
+        if (!map) {
+            return;
+        }
+        for (int code = minCode; code <= maxCode; ++code) {
+            const KeySym* syms = map + (code - minCode) * perCode;
+            if (std::all_of(syms, syms + perCode, [](KeySym sym) { return sym == NoSymbol; })) {
+                if (spareKeys.size() < maxSpareKeys) {
+                    spareKeys.push_back(static_cast<KeyCode>(code));
+                }
+                continue;
+            }
+            for (int level = 0; level < std::min(perCode, 2); ++level) {
+                if (syms[level] == NoSymbol) {
+                    continue;
+                }
+                auto it = keymap.find(syms[level]);
+                if (it == keymap.end() || (it->second.shift && level == 0)) {
+                    keymap[syms[level]] = {static_cast<KeyCode>(code), level == 1};
+                }
+            }
+        }
+        XFree(map);
+    }
+
+    // Maps the unmapped keysyms from syms[from] on, up to one per spare
+    // key, in one batch, and returns which key each went to.
+    std::unordered_map<KeySym, KeyCode> remapFrom(const std::vector<KeySym>& syms, std::size_t from) {
+        std::unordered_map<KeySym, KeyCode> remapped;
+        for (std::size_t i = from; i < syms.size() && remapped.size() < spareKeys.size(); ++i) {
+            KeySym sym = syms[i];
+            if (sym == NoSymbol || keymap.count(sym) || remapped.count(sym)) {
+                continue;
+            }
+            KeyCode key = spareKeys[remapped.size()];
+            KeySym both[2] = {sym, sym}; // Same keysym shifted or not
+            XChangeKeyboardMapping(display, key, 2, both, 1);
+            remapped.emplace(sym, key);
+        }
+        XSync(display, False);
+        std::this_thread::sleep_for(std::chrono::milliseconds(mappingSettleMs));
+        return remapped;
+    }
+
+    void clearSpareKeys(std::size_t count) {
+        KeySym none[2] = {NoSymbol, NoSymbol};
+        for (std::size_t i = 0; i < count; ++i) {
+            XChangeKeyboardMapping(display, spareKeys[i], 2, none, 1);
+        }
+    }
+
+    void strike(const KeyStroke& stroke) {
+        if (stroke.shift) {
+            XTestFakeKeyEvent(display, shiftKey, True, CurrentTime);
+        }
+        XTestFakeKeyEvent(display, stroke.code, True, CurrentTime);
+        XTestFakeKeyEvent(display, stroke.code, False, CurrentTime);
+        if (stroke.shift) {
+            XTestFakeKeyEvent(display, shiftKey, False, CurrentTime);
+        }
+    }
+
+    // Whether the user asked to stop command: cancel() since it was queued,
+    // or Esc held down now.
+    bool cancelled(const Command& command) {
+        if (command.generation != generation.load()) {
+            return true;
+        }
+        char keys[32] = {};
+        XQueryKeymap(display, keys);
+        return escapeKey != 0 && (keys[escapeKey / 8] >> (escapeKey % 8)) & 1;
+    }
+
+    // Waits for the server to process what was sent and sizes the next
+    // chunk by how long that took. False if the command was cancelled.
+    bool pace(const Command& command, int& chunk) {
+        Clock::time_point start = Clock::now();
+        XSync(display, False);
+        auto took = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+        if (took.count() < slowSyncUs) {
+            chunk = std::min(chunk * 2, maxChunk);
+        } else {
+            chunk = std::max(chunk / 2, minChunk);
+            std::this_thread::sleep_for(took);
+        }
+        return !cancelled(command);
+    }
+
+    // Sleeps ms in short slices, so Esc is noticed during long pauses.
+    bool pause(const Command& command, int ms) {
+        for (int slept = 0; slept < ms; slept += cancelPollMs) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(cancelPollMs, ms - slept)));
+            if (cancelled(command)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Types every field of command, with Tab between fields.
+    void type(const Command& command) {
+        if (!openDisplay()) {
+            return;
+        }
+        loadKeymap();
+        Clock::time_point started = Clock::now();
+        std::unordered_map<KeySym, KeyCode> remapped;
+        bool usedSpares = false;
+        bool stopped = false;
+        int chunk = minChunk;
+        int sinceSync = 0;
+        int count = 0;
+        int skipped = 0;
+        std::size_t field = 0;
+        for (; field < command.fields.size(); ++field) {
+            if (field > 0) {
+                // The form may take a moment to move the focus.
+                strike({tabKey, false});
+                sinceSync = 0;
+                if (!pace(command, chunk) || !pause(command, command.fieldDelayMs)) {
+                    stopped = true;
+                    break;
+                }
+            }
+            std::vector<KeySym> syms = keysymsOf(command.fields[field].view());
+            for (std::size_t i = 0; i < syms.size(); ++i) {
+                if (syms[i] == NoSymbol) {
+                    continue;
+                }
+                KeyStroke stroke;
+                auto known = keymap.find(syms[i]);
+                if (known != keymap.end()) {
+                    stroke = known->second;
+                } else {
+                    auto spare = remapped.find(syms[i]);
+                    if (spare == remapped.end()) {
+                        if (spareKeys.empty()) {
+                            ++skipped;
+                            continue;
+                        }
+                        // Keys already sent must reach the target before
+                        // their keycodes mean something else.
+                        sinceSync = 0;
+                        if (!pace(command, chunk)) {
+                            stopped = true;
+                            break;
+                        }
+                        remapped = remapFrom(syms, i);
+                        usedSpares = true;
+                        spare = remapped.find(syms[i]);
+                    }
+                    stroke.code = spare->second;
+                }
+                strike(stroke);
+                ++count;
+                if (++sinceSync >= chunk) {
+                    sinceSync = 0;
+                    if (!pace(command, chunk)) {
+                        stopped = true;
+                        break;
+                    }
+                }
+            }
+            if (stopped) {
+                break;
+            }
+        }
+        XSync(display, False);
+        if (usedSpares) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(mappingSettleMs));
+            clearSpareKeys(spareKeys.size());
+            XFlush(display);
+        }
+        qint64 elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+        if (stopped && command.kind == Command::Fill) {
+            emit failed(QString("Form fill cancelled in field %1 of %2").arg(field + 1).arg(command.fields.size()));
+        } else if (stopped) {
+            emit failed(QString("Typing cancelled after %1 character(s)").arg(count));
+        } else if (command.kind == Command::Fill) {
+            emit filled(static_cast<int>(command.fields.size()), count, elapsedUs);
+        } else {
+            emit typed(count, elapsedUs);
+        }
+        if (skipped > 0) {
+            emit failed(QString("Could not type %1 character(s): no spare key to map them to").arg(skipped));
+        }
+    }
+
+    Display* display = nullptr;
+    KeyCode controlKey = 0;
+    KeyCode shiftKey = 0;
+    KeyCode vKey = 0;
+    KeyCode escapeKey = 0;
+    KeyCode tabKey = 0;
+    std::unordered_map<KeySym, KeyStroke> keymap;
+    std::vector<KeyCode> spareKeys;
+#else
+    void closeDisplay() {}
+
+    void paste(const Command&) { emit failed("Paste injection is only supported on X11"); }
+
+    void type(const Command&) { emit failed("Paste injection is only supported on X11"); }
+#endif
+
+    std::mutex mutex;
+    std::deque<Command> queue;
+    bool drainScheduled = false;
+    std::atomic<int> generation{0}; // Bumped by cancel()
+};
@@ -0,0 +1,470 @@
+#pragma once
+
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "config_journal.h"
+#include "entry_store.h"
+#include "snapshot_cache.h"
+#include "usage_index.h"
+
+// Result of a load job, handed to the UI thread by PersistenceWorker::loaded.
+struct LoadedConfig {
+    EntryStore entries;
+    std::vector<ConfigIssue> issues; // Malformed items that were skipped
+    bool created = false; // config.json did not exist and defaults were written
+    std::string recovered; // What startup recovery repaired, if anything
+    bool fromSnapshot = false; // Entries came from the mapped binary snapshot
+    std::uint64_t loadSerial = 0; // Hand back to submitCompaction() once applied
+    bool ok = false;
+    std::string error;
+};
+
+using LoadedConfigPtr = std::shared_ptr<LoadedConfig>;
+Q_DECLARE_METATYPE(LoadedConfigPtr)
+
+using UsageRecordsPtr = std::shared_ptr<const std::vector<UsageIndex::Record>>;
+Q_DECLARE_METATYPE(UsageRecordsPtr)
+
+// A form-fill sequence: entries whose values are typed one after another
+// with Tab between them, kept in config.sequences. A field whose entry has
+// been deleted becomes blankField, for which only the Tab is sent, so the
+// fields after it still land where they belong.
+struct FillSequence {
+    static constexpr EntryStore::EntryId blankField = 0; // Entry IDs start at 1
+
+    std::string name;
+    std::vector<EntryStore::EntryId> entries;
+    int fieldDelayMs = 0; // Extra pause after each Tab, for slow forms
+};
+
+using FillSequencesPtr = std::shared_ptr<const std::vector<FillSequence>>;
+Q_DECLARE_METATYPE(FillSequencesPtr)
+
+// Owns the config files and does all disk I/O and JSON work on the thread
+// it is moved to. The submit*/request* methods may be called from any
+// thread; they append to a single FIFO job queue that the worker drains in
+// order, so a load always observes every mutation submitted before it.
+// Consecutive mutations are written to the journal in one append, and
+// appends are flushed to stable storage as a group at most syncDelayMs
+// after the first unsynced one. Completion is reported through queued
+// signals.
+class PersistenceWorker : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int syncDelayMs = 100;
+
+    explicit PersistenceWorker(const std::string& configPath, QObject* parent = nullptr)
+        : QObject(parent), journal(configPath) {
+        qRegisterMetaType<LoadedConfigPtr>("LoadedConfigPtr");
+        qRegisterMetaType<UsageRecordsPtr>("UsageRecordsPtr");
+        qRegisterMetaType<FillSequencesPtr>("FillSequencesPtr");
+    }
+
+    const std::string& path() const { return journal.path(); }
+
+    void submitAdd(EntryStore::EntryId id, const std::string& name, const std::string& value,
+                   const std::vector<std::string>& tags = {}) {
+        Job job;
+        job.kind = Job::Append;
+        job.record = ConfigJournal::addRecord(id, name, value, tags);
+        enqueue(std::move(job));
+    }
+
+    void submitDelete(EntryStore::EntryId id) {
+        Job job;
+        job.kind = Job::Append;
+        job.record = ConfigJournal::deleteRecord(id);
+        enqueue(std::move(job));
+    }
+
+    // snapshot must reflect every mutation submitted before this call, on
+    // top of the load with loadSerial. Copying an EntryStore shares its
+    // text, so passing the live store only copies its index arrays.
+    //
+    // If config.json changed on disk since that load, or a newer load has
+    // not been applied yet, nothing is written: the worker emits
+    // compactionConflict() and the owner should reload, which replays the
+    // journal on top of the new file.
+    void submitCompaction(const EntryStore& snapshot, std::uint64_t loadSerial) {
+        Job job;
+        job.kind = Job::Compact;
+        job.snapshot = snapshot;
+        job.loadSerial = loadSerial;
+        enqueue(std::move(job));
+    }
+
+    // Replaces config.usage, the usage counters, with records. The owner
+    // batches uses and calls this now and then rather than per use.
+    void submitUsage(std::vector<UsageIndex::Record> records) {
+        Job job;
+        job.kind = Job::SaveUsage;
+        job.usage = std::move(records);
+        enqueue(std::move(job));
+    }
+
+    // Reads config.usage and emits usageLoaded(); no records if it does not
+    // exist yet.
+    void requestUsage() {
+        Job job;
+        job.kind = Job::LoadUsage;
+        enqueue(std::move(job));
+    }
+
+    // Replaces config.sequences with sequences.
+    void submitSequences(std::vector<FillSequence> sequences) {
+        Job job;
+        job.kind = Job::SaveSequences;
+        job.sequences = std::move(sequences);
+        enqueue(std::move(job));
+    }
+
+    // Reads config.sequences and emits sequencesLoaded(); none if it does
+    // not exist yet.
+    void requestSequences() {
+        Job job;
+        job.kind = Job::LoadSequences;
+        enqueue(std::move(job));
+    }
+
+    // Reads config.json (writing the defaults first if it is missing),
+    // replays the journal and emits loaded() with generation echoed back.
+    void requestLoad(quint64 generation) {
+        Job job;
+        job.kind = Job::Load;
+        job.generation = generation;
+        enqueue(std::move(job));
+    }
+
+    // Runs whatever is still queued and syncs the journal. Called on the
+    // owning thread once the worker thread has stopped, so nothing
+    // submitted during shutdown is lost.
+    void finish() {
+        drain();
+        syncNow();
+    }
+
+signals:
+    void loaded(LoadedConfigPtr result, quint64 generation);
+    void usageLoaded(UsageRecordsPtr records);
+    void sequencesLoaded(FillSequencesPtr sequences);
+    void persisted(int records);
+    void compactionNeeded();
+    void compactionConflict();
+    void compacted();
+    void failed(QString message);
+
+private:
+    using json = nlohmann::json;
+
+    struct Job {
+        enum Kind { Append, Compact, Load, SaveUsage, LoadUsage, SaveSequences, LoadSequences };
+        Kind kind = Append;
+        json record;
+        EntryStore snapshot;
+        std::vector<UsageIndex::Record> usage;
+        std::vector<FillSequence> sequences;
+        quint64 generation = 0;
+        std::uint64_t loadSerial = 0; // Compact only
+    };
+
+    void drain() {
+        std::deque<Job> jobs;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.swap(queue);
+            drainScheduled = false;
+        }
+        std::vector<json> batch;
+        for (Job& job : jobs) {
+            if (job.kind == Job::Append) {
+                batch.push_back(std::move(job.record));
+                continue;
+            }
+            flush(batch);
+            if (job.kind == Job::Compact) {
+                compact(job.snapshot, job.loadSerial);
+            } else if (job.kind == Job::SaveUsage) {
+                saveUsage(job.usage);
+            } else if (job.kind == Job::LoadUsage) {
+                loadUsage();
+            } else if (job.kind == Job::SaveSequences) {
+                saveSequences(job.sequences);
+            } else if (job.kind == Job::LoadSequences) {
+                loadSequences();
+            } else {
+                load(job.generation);
+            }
+        }
+        flush(batch);
+        scheduleSync();
+        if (!compactionRequested && journal.needsCompaction()) {
+            compactionRequested = true;
+            emit compactionNeeded();
+        }
+    }
+
+    void scheduleSync() {
+        if (!journal.needsSync()) {
+            return;
+        }
+        if (QThread::currentThread() != thread()) {
+            syncNow();
+            return;
+        }
+        if (!syncTimer) {
+            syncTimer = new QTimer(this);
+            syncTimer->setSingleShot(true);
+            syncTimer->setInterval(syncDelayMs);
+            connect(syncTimer, &QTimer::timeout, this, &PersistenceWorker::syncNow);
+        }
+        if (!syncTimer->isActive()) {
+            syncTimer->start();
+        }
+    }
+
+    void syncNow() {
+        try {
+            journal.sync();
+        } catch (const std::exception& e) {
+            emit failed(QString("Error syncing config journal: %1").arg(e.what()));
+        }
+    }
+
+    void enqueue(Job job) {
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(job));
+            schedule = !drainScheduled;
+            drainScheduled = true;
+        }
+        if (schedule) {
+            QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+        }
+    }
+
+    void flush(std::vector<json>& batch) {
+        if (batch.empty()) {
+            return;
+        }
+        int count = static_cast<int>(batch.size());
+        try {
+            journal.append(batch);
+            emit persisted(count);
+        } catch (const std::exception& e) {
+            emit failed(QString("Error saving config: %1").arg(e.what()));
+        }
+        batch.clear();
+    }
+
+    void compact(const EntryStore& snapshot, std::uint64_t loadSerial) {
+        compactionRequested = false;
+        try {
+            // An edit made since the load, e.g. within the watcher's
+            // debounce, would otherwise be overwritten without a trace.
+            // Compaction is not requested again until a load succeeds.
+            if (loadSerial != loadCount || !(SnapshotSourceKey::of(journal.path()) == sourceKey)) {
+                compactionRequested = true;
+                emit compactionConflict();
+                return;
+            }
+            journal.compact(snapshot.toJson());
+            emit compacted();
+            SnapshotSourceKey key = SnapshotSourceKey::of(journal.path());
+            sourceKey = key;
+            if (SnapshotCache::write(snapshotPath(), key, journal.lastSeq(), snapshot)) {
+                snapshotKey = key;
+            }
+        } catch (const std::exception& e) {
+            emit failed(QString("Error compacting config journal: %1").arg(e.what()));
+        }
+    }
+
+    void load(quint64 generation) {
+        auto result = std::make_shared<LoadedConfig>();
+        try {
+            if (!recovered) {
+                recovered = true;
+                result->recovered = journal.recover();
+            }
+            result->created = ensureConfigExists();
+            // Keyed before parsing: if config.json changes in between, the
+            // snapshot written below simply fails validation next time.
+            SnapshotSourceKey key = SnapshotSourceKey::of(journal.path());
+            sourceKey = key;
+            result->loadSerial = ++loadCount;
+            std::uint64_t snapshotSeq = 0;
+            if (!startupDone && SnapshotCache::map(snapshotPath(), key, result->entries, snapshotSeq)) {
+                journal.adopt(journal.replay(result->entries, snapshotSeq));
+                result->fromSnapshot = true;
+                snapshotKey = key;
+            } else {
+                result->entries.clear();
+                ConfigJournal::ReplayResult replay = journal.load(result->entries);
+                result->issues = std::move(replay.issues);
+                // Items without a usable "id" (older configs, copied items)
+                // only keep the IDs just assigned once they are written back,
+                // since journal records refer to them from now on; compact()
+                // also refreshes the snapshot. Otherwise the snapshot holds
+                // config.json plus the journal replayed so far, and later
+                // records are replayed on top of it. Configs with malformed
+                // items keep going through JSON so the issues are reported on
+                // every launch.
+                if (result->entries.assignMissingIds() > 0) {
+                    compact(result->entries, result->loadSerial);
+                } else if (result->issues.empty() && !(snapshotKey == key)
+                           && SnapshotCache::write(snapshotPath(), key, journal.lastSeq(), result->entries)) {
+                    snapshotKey = key;
+                }
+            }
+            startupDone = true;
+            compactionRequested = false;
+            result->ok = true;
+        } catch (const std::exception& e) {
+            result->error = e.what();
+        }
+        emit loaded(result, generation);
+    }
+
+    std::string snapshotPath() const { return SnapshotCache::pathFor(journal.path()); }
+
+    std::string usagePath() const {
+        return std::filesystem::path(journal.path()).replace_extension(".usage").string();
+    }
+
+    void saveUsage(const std::vector<UsageIndex::Record>& records) {
+        json entries = json::array();
+        for (const UsageIndex::Record& record : records) {
+            entries.push_back({{"id", record.id}, {"uses", record.uses}, {"key", record.key}});
+        }
+        json usage = {{"halfLife", UsageIndex::halfLife}, {"entries", entries}};
+        try {
+            AtomicFile::write(usagePath(), usage.dump());
+        } catch (const std::exception& e) {
+            emit failed(QString("Error saving usage counters: %1").arg(e.what()));
+        }
+    }
+
+    void loadUsage() {
+        auto records = std::make_shared<std::vector<UsageIndex::Record>>();
+        std::ifstream file(usagePath(), std::ios::binary);
+        if (file.is_open()) {
+            json usage = json::parse(file, nullptr, false);
+            const json* entries = usage.is_object() && usage.contains("entries") ? &usage["entries"] : nullptr;
+            if (!entries || !entries->is_array()) {
+                emit failed("Ignoring unreadable usage counters in config.usage");
+            } else {
+                for (const json& entry : *entries) {
+                    // A hand-edited record of the wrong shape is skipped
+                    // rather than thrown on.
+                    if (!entry.is_object() || !entry.contains("id") || !entry["id"].is_number_unsigned()
+                        || !entry.contains("uses") || !entry["uses"].is_number_unsigned()
+                        || (entry.contains("key") && !entry["key"].is_number())) {
+                        continue;
+                    }
+                    UsageIndex::Record record;
+                    record.id = entry["id"].get<std::uint64_t>();
+                    record.uses = static_cast<std::uint32_t>(
+                        std::min<std::uint64_t>(entry["uses"].get<std::uint64_t>(), std::numeric_limits<std::uint32_t>::max()));
+                    record.key = entry.contains("key") ? entry["key"].get<double>() : 0.0;
+                    if (record.id != 0 && record.uses > 0) {
+                        records->push_back(record);
+                    }
+                }
+            }
+        }
+        emit usageLoaded(records);
+    }
+
+    std::string sequencesPath() const {
+        return std::filesystem::path(journal.path()).replace_extension(".sequences").string();
+    }
+
+    void saveSequences(const std::vector<FillSequence>& sequences) {
+        json list = json::array();
+        for (const FillSequence& sequence : sequences) {
+            list.push_back({{"name", sequence.name}, {"entries", sequence.entries}, {"fieldDelayMs", sequence.fieldDelayMs}});
+        }
+        try {
+            AtomicFile::write(sequencesPath(), json({{"sequences", list}}).dump(2));
+        } catch (const std::exception& e) {
+            emit failed(QString("Error saving sequences: %1").arg(e.what()));
+        }
+    }
+
+    void loadSequences() {
+        auto sequences = std::make_shared<std::vector<FillSequence>>();
+        std::ifstream file(sequencesPath(), std::ios::binary);
+        if (file.is_open()) {
+            json config = json::parse(file, nullptr, false);
+            const json* list = config.is_object() && config.contains("sequences") ? &config["sequences"] : nullptr;
+            if (!list || !list->is_array()) {
+                emit failed("Ignoring unreadable sequences in config.sequences");
+            } else {
+                for (const json& item : *list) {
+                    if (!item.is_object() || !item.contains("name") || !item["name"].is_string()
+                        || !item.contains("entries") || !item["entries"].is_array()) {
+                        continue;
+                    }
+                    FillSequence sequence;
+                    sequence.name = item["name"].get<std::string>();
+                    for (const json& id : item["entries"]) {
+                        if (id.is_number_unsigned()) {
+                            sequence.entries.push_back(id.get<EntryStore::EntryId>());
+                        }
+                    }
+                    if (item.contains("fieldDelayMs") && item["fieldDelayMs"].is_number_integer()) {
+                        sequence.fieldDelayMs = std::max(0, item["fieldDelayMs"].get<int>());
+                    }
+                    sequences->push_back(std::move(sequence));
+                }
+            }
+        }
+        emit sequencesLoaded(sequences);
+    }
+
+    bool ensureConfigExists() {
+        std::filesystem::path configPath(journal.path());
+        if (std::filesystem::exists(configPath)) {
+            return false;
+        }
+        if (configPath.has_parent_path()) {
+            std::filesystem::create_directories(configPath.parent_path());
+        }
+        json config = {
+            {"items", {
+                {{"id", 1}, {"name", "Full Name"}, {"value", "Joooooooooohn Dooooooooooe"}},
+                {{"id", 2}, {"name", "Email"}, {"value", "john@example.com"}},
+                {{"id", 3}, {"name", "Name"}, {"value", "John"}},
+                {{"id", 4}, {"name", "Last Name"}, {"value", "Doe"}}
+            }}
+        };
+        AtomicFile::write(configPath.string(), config.dump(2));
+        return true;
+    }
+
+    ConfigJournal journal;
+    std::mutex mutex;
+    std::deque<Job> queue;
+    bool drainScheduled = false;
+    bool compactionRequested = false;
+    bool recovered = false;
+    bool startupDone = false;
+    SnapshotSourceKey snapshotKey;
+    SnapshotSourceKey sourceKey; // config.json as the last load read or compaction wrote it
+    std::uint64_t loadCount = 0;
+    QTimer* syncTimer = nullptr;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+#include "entry_store.h"
+
+// Match sets of the recent queries of a search session, keyed by folded
+// query and mode.
+//
+// Matching only gets stricter as a query grows: in substring mode every
+// match of "emai" is a match of any cached query it contains ("ema",
+// "mai"), and in fuzzy mode of any cached query that is a subsequence of
+// it. So a longer query only re-checks the smallest such cached set, and
+// deleting a character finds the shorter query's set still cached. The
+// owner clears the cache whenever entries are added, removed or changed.
+class QueryCache {
+public:
+    using EntryId = EntryStore::EntryId;
+
+    static constexpr std::size_t capacity = 32;
+
+    void clear() { entries.clear(); }
+
+    // The cached matches of query, or null.
+    const std::vector<EntryId>* find(bool fuzzy, const std::string& query) const {
+        for (const Entry& entry : entries) {
+            if (entry.fuzzy == fuzzy && entry.query == query) {
+                return &entry.ids;
+            }
+        }
+        return nullptr;
+    }
+
+    // The smallest cached match set that contains every match of query,
+    // or null if no cached query is narrowed by it.
+    const std::vector<EntryId>* narrowest(bool fuzzy, const std::string& query) const {
+        const std::vector<EntryId>* best = nullptr;
+        for (const Entry& entry : entries) {
+            if (entry.fuzzy != fuzzy || entry.query.size() >= query.size()) {
+                continue;
+            }
+            bool narrows = fuzzy ? isSubsequence(entry.query, query) : query.find(entry.query) != std::string::npos;
+            if (narrows && (!best || entry.ids.size() < best->size())) {
+                best = &entry.ids;
+            }
+        }
+        return best;
+    }
+
+    void insert(bool fuzzy, std::string query, std::vector<EntryId> ids) {
+        if (entries.size() == capacity) {
+            entries.pop_front();
+        }
+        entries.push_back(Entry{fuzzy, std::move(query), std::move(ids)});
+    }
+
+private:
+    struct Entry {
+        bool fuzzy;
+        std::string query;
+        std::vector<EntryId> ids;
+    };
+
+    static bool isSubsequence(const std::string& small, const std::string& large) {
+        std::size_t i = 0;
+        for (char c : large) {
+            if (i < small.size() && small[i] == c) {
+                ++i;
+            }
+        }
+        return i == small.size();
+    }
+
+    std::deque<Entry> entries; // Oldest first
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Compressed set of 64-bit IDs in the style of Roaring bitmaps.
+//
+// IDs are split into a high key and a low 16 bits. Each key present has a
+// container for its low halves: a sorted array of up to arrayLimit values,
+// or a 65536-bit bitmap once it holds more. A sparse set costs two bytes
+// per ID and a dense one an eighth of a byte, and intersecting two sets
+// walks only the keys both have, a word-wise AND for bitmap containers.
+class RoaringBitmap {
+public:
+    using Value = std::uint64_t;
+
+    static constexpr std::size_t arrayLimit = 4096;
+    static constexpr std::size_t bitmapWords = 65536 / 64;
+
+    bool isEmpty() const { return containers.empty(); }
+
+    std::size_t cardinality() const {
+        std::size_t total = 0;
+        for (const Container& container : containers) {
+            total += container.cardinality;
+        }
+        return total;
+    }
+
+    void clear() { containers.clear(); }
+
+    // Returns false if value was present already.
+    bool add(Value value) {
+        auto it = lowerBound(value >> 16);
+        if (it == containers.end() || it->key != value >> 16) {
+            it = containers.insert(it, Container{value >> 16, 0, {}, {}});
+        }
+        std::uint16_t low = static_cast<std::uint16_t>(value);
+        Container& container = *it;
+        if (container.isBitmap()) {
+            std::uint64_t& word = container.bits[low >> 6];
+            std::uint64_t bit = std::uint64_t(1) << (low & 63);
+            if (word & bit) {
+                return false;
+            }
+            word |= bit;
+        } else {
+            auto at = std::lower_bound(container.array.begin(), container.array.end(), low);
+            if (at != container.array.end() && *at == low) {
+                return false;
+            }
+            container.array.insert(at, low);
+            if (container.array.size() > arrayLimit) {
+                toBitmap(container);
+            }
+        }
+        ++container.cardinality;
+        return true;
+    }
+
+    // Returns false if value was not present.
+    bool remove(Value value) {
+        auto it = lowerBound(value >> 16);
+        if (it == containers.end() || it->key != value >> 16) {
+            return false;
+        }
+        std::uint16_t low = static_cast<std::uint16_t>(value);
+        Container& container = *it;
+        if (container.isBitmap()) {
+            std::uint64_t& word = container.bits[low >> 6];
+            std::uint64_t bit = std::uint64_t(1) << (low & 63);
+            if (!(word & bit)) {
+                return false;
+            }
+            word &= ~bit;
+        } else {
+            auto at = std::lower_bound(container.array.begin(), container.array.end(), low);
+            if (at == container.array.end() || *at != low) {
+                return false;
+            }
+            container.array.erase(at);
+        }
+        if (--container.cardinality == 0) {
+            containers.erase(it);
+        } else if (container.isBitmap() && container.cardinality <= arrayLimit) {
+            toArray(container);
+        }
+        return true;
+    }
+
+    bool contains(Value value) const {
+        auto it = std::lower_bound(containers.begin(), containers.end(), value >> 16,
+                                   [](const Container& c, Value key) { return c.key < key; });
+        if (it == containers.end() || it->key != value >> 16) {
+            return false;
+        }
+        std::uint16_t low = static_cast<std::uint16_t>(value);
+        if (it->isBitmap()) {
+            return (it->bits[low >> 6] >> (low & 63)) & 1;
+        }
+        return std::binary_search(it->array.begin(), it->array.end(), low);
+    }
+
+    // Calls f(value) for every value in ascending order.
+    template <typename F>
+    void forEach(F&& f) const {
+        for (const Container& container : containers) {
+            const Value high = container.key << 16;
+            if (container.isBitmap()) {
+                for (std::size_t w = 0; w < bitmapWords; ++w) {
+                    for (std::uint64_t word = container.bits[w]; word != 0; word &= word - 1) {
+                        f(high | (w * 64 + static_cast<Value>(lowestBit(word))));
+                    }
+                }
+            } else {
+                for (std::uint16_t low : container.array) {
+                    f(high | low);
+                }
+            }
+        }
+    }
+
+    static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap result;
+        auto i = a.containers.begin();
+        auto j = b.containers.begin();
+        while (i != a.containers.end() && j != b.containers.end()) {
+            if (i->key < j->key) {
+                ++i;
+            } else if (j->key < i->key) {
+                ++j;
+            } else {
+                Container both = intersect(*i, *j);
+                if (both.cardinality > 0) {
+                    result.containers.push_back(std::move(both));
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    // Values of a that are not in b.
+    static RoaringBitmap subtract(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap result;
+        auto j = b.containers.begin();
+        for (const Container& container : a.containers) {
+            while (j != b.containers.end() && j->key < container.key) {
+                ++j;
+            }
+            if (j == b.containers.end() || j->key != container.key) {
+                result.containers.push_back(container);
+                continue;
+            }
+            Container rest = subtract(container, *j);
+            if (rest.cardinality > 0) {
+                result.containers.push_back(std::move(rest));
+            }
+        }
+        return result;
+    }
+
+    std::size_t memoryUsage() const {
+        std::size_t bytes = containers.capacity() * sizeof(Container);
+        for (const Container& container : containers) {
+            bytes += container.array.capacity() * sizeof(std::uint16_t) + container.bits.capacity() * sizeof(std::uint64_t);
+        }
+        return bytes;
+    }
+
+private:
+    struct Container {
+        Value key; // The value's bits above the low 16
+        std::uint32_t cardinality;
+        std::vector<std::uint16_t> array; // Sorted; used while bits is empty
+        std::vector<std::uint64_t> bits;  // bitmapWords words once past arrayLimit
+
+        bool isBitmap() const { return !bits.empty(); }
+    };
+
+    // Index of the lowest set bit; word must not be 0.
+    static unsigned lowestBit(std::uint64_t word) {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward64(&index, word);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+    }
+
+    static std::uint32_t bitCount(std::uint64_t word) {
+#ifdef _MSC_VER
+        return static_cast<std::uint32_t>(std::bitset<64>(word).count());
+#else
+        return static_cast<std::uint32_t>(__builtin_popcountll(word));
+#endif
+    }
+
+    std::vector<Container>::iterator lowerBound(Value key) {
+        return std::lower_bound(containers.begin(), containers.end(), key,
+                                [](const Container& c, Value k) { return c.key < k; });
+    }
+
+    static void toBitmap(Container& container) {
+        container.bits.assign(bitmapWords, 0);
+        for (std::uint16_t low : container.array) {
+            container.bits[low >> 6] |= std::uint64_t(1) << (low & 63);
+        }
+        container.array = std::vector<std::uint16_t>();
+    }
+
+    static void toArray(Container& container) {
+        container.array.clear();
+        container.array.reserve(container.cardinality);
+        for (std::size_t w = 0; w < bitmapWords; ++w) {
+            for (std::uint64_t word = container.bits[w]; word != 0; word &= word - 1) {
+                container.array.push_back(static_cast<std::uint16_t>(w * 64 + lowestBit(word)));
+            }
+        }
+        container.bits = std::vector<std::uint64_t>();
+    }
+
+    static bool testBit(const Container& container, std::uint16_t low) {
+        return (container.bits[low >> 6] >> (low & 63)) & 1;
+    }
+
+    // Bitmap results that have shrunk to arrayLimit or fewer go back to
+    // being arrays.
+    static Container finishBitmap(Container container) {
+        std::uint32_t count = 0;
+        for (std::uint64_t word : container.bits) {
+            count += bitCount(word);
+        }
+        container.cardinality = count;
+        if (count == 0) {
+            container.bits.clear();
+        } else if (count <= arrayLimit) {
+            toArray(container);
+        }
+        return container;
+    }
+
+    static Container intersect(const Container& a, const Container& b) {
+        Container result{a.key, 0, {}, {}};
+        if (a.isBitmap() && b.isBitmap()) {
+            result.bits.resize(bitmapWords);
+            for (std::size_t w = 0; w < bitmapWords; ++w) {
+                result.bits[w] = a.bits[w] & b.bits[w];
+            }
+            return finishBitmap(std::move(result));
+        }
+        if (a.isBitmap() || b.isBitmap()) {
+            const Container& bitmap = a.isBitmap() ? a : b;
+            const Container& array = a.isBitmap() ? b : a;
+            for (std::uint16_t low : array.array) {
+                if (testBit(bitmap, low)) {
+                    result.array.push_back(low);
+                }
+            }
+        } else {
+            std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                  std::back_inserter(result.array));
+        }
+        result.cardinality = static_cast<std::uint32_t>(result.array.size());
+        return result;
+    }
+
+    static Container subtract(const Container& a, const Container& b) {
+        Container result{a.key, 0, {}, {}};
+        if (a.isBitmap()) {
+            result.bits = a.bits;
+            if (b.isBitmap()) {
+                for (std::size_t w = 0; w < bitmapWords; ++w) {
+                    result.bits[w] &= ~b.bits[w];
+                }
+            } else {
+                for (std::uint16_t low : b.array) {
+                    result.bits[low >> 6] &= ~(std::uint64_t(1) << (low & 63));
+                }
+            }
+            return finishBitmap(std::move(result));
+        }
+        if (b.isBitmap()) {
+            for (std::uint16_t low : a.array) {
+                if (!testBit(b, low)) {
+                    result.array.push_back(low);
+                }
+            }
+        } else {
+            std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                std::back_inserter(result.array));
+        }
+        result.cardinality = static_cast<std::uint32_t>(result.array.size());
+        return result;
+    }
+
+    std::vector<Container> containers; // Sorted by key
+};
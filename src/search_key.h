@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QChar>
+#include <QString>
+#include <string>
+#include "entry_store.h"
+
+// The form text is matched in: NFKC, case-folded and without accents, as
+// UTF-8. "Ｃafé" and "CAFE" have the same key, so every search engine can
+// compare keys byte by byte. Keys are made once per entry when it is
+// indexed and once per query, never per comparison.
+struct SearchKey {
+    static std::string fold(EntryText text) { return fold(text.data, text.length); }
+
+    static std::string fold(const QString& text) {
+        return fold(reinterpret_cast<const char16_t*>(text.utf16()), text.size());
+    }
+
+    static std::string fold(const char16_t* text, int length) {
+        std::string key;
+        key.reserve(static_cast<std::size_t>(length));
+        for (int i = 0; i < length; ++i) {
+            if (text[i] >= 0x80) {
+                return foldUnicode(QString(reinterpret_cast<const QChar*>(text), length));
+            }
+            char c = static_cast<char>(text[i]);
+            key.push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c);
+        }
+        return key;
+    }
+
+private:
+    // Compatibility decomposition splits accented letters into a base and
+    // combining marks, which are dropped before folding and recomposing.
+    static std::string foldUnicode(const QString& text) {
+        QString decomposed = text.normalized(QString::NormalizationForm_KD);
+        QString bare;
+        bare.reserve(decomposed.size());
+        for (QChar c : decomposed) {
+            if (c.category() != QChar::Mark_NonSpacing) {
+                bare.append(c);
+            }
+        }
+        return bare.toCaseFolded().normalized(QString::NormalizationForm_KC).toStdString();
+    }
+};
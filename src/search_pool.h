@@ -0,0 +1,137 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for search scans. Each worker has its own task
+// deque: it takes from the front of its own and, once that is empty,
+// steals from the back of the others', so chunks that take longer than
+// their neighbours do not leave cores idle.
+class SearchPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit SearchPool(unsigned threadCount = defaultThreadCount()) {
+        for (unsigned i = 0; i < threadCount; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (unsigned i = 0; i < threadCount; ++i) {
+            threads.emplace_back([this, i]() { run(i); });
+        }
+    }
+
+    ~SearchPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    SearchPool(const SearchPool&) = delete;
+    SearchPool& operator=(const SearchPool&) = delete;
+
+    // One core is left to the UI thread.
+    static unsigned defaultThreadCount() {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 2 ? cores - 1 : 1;
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Deals tasks round-robin onto the workers' deques.
+    void submit(std::vector<Task> tasks) {
+        if (tasks.empty()) {
+            return;
+        }
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            Worker& worker = *workers[(next + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(tasks[i]));
+        }
+        next = (next + tasks.size()) % workers.size();
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            pending += tasks.size();
+            queued += tasks.size();
+        }
+        wake.notify_all();
+    }
+
+    // Blocks until every submitted task has finished running.
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        idle.wait(lock, [this]() { return pending == 0; });
+    }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool take(unsigned self, Task& task) {
+        {
+            Worker& own = *workers[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < workers.size(); ++i) {
+            Worker& victim = *workers[(self + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(unsigned self) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                wake.wait(lock, [this]() { return stopping || queued > 0; });
+                if (stopping) {
+                    return;
+                }
+                // Claims one queued task; it is in some deque already, so
+                // take() finds it even if another worker is faster.
+                --queued;
+            }
+            Task task;
+            while (!take(self, task)) {
+                std::this_thread::yield();
+            }
+            task();
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--pending == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::size_t next = 0; // Submitting thread only
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::size_t pending = 0; // Submitted and not yet finished
+    std::size_t queued = 0;  // Submitted and not yet claimed by a worker
+    bool stopping = false;
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "durable_file.h"
+#include "entry_store.h"
+
+// Identifies the exact config.json a snapshot was built from.
+struct SnapshotSourceKey {
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    std::uint64_t hash = 0;
+
+    bool operator==(const SnapshotSourceKey& other) const {
+        return size == other.size && mtime == other.mtime && hash == other.hash;
+    }
+
+    // Stats and hashes (FNV-1a) the file. Throws if it cannot be read.
+    static SnapshotSourceKey of(const std::string& path) {
+        SnapshotSourceKey key;
+        key.size = std::filesystem::file_size(path);
+        key.mtime = static_cast<std::int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        std::uint64_t hash = 14695981039346656037ull;
+        char buffer[1 << 16];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+            std::streamsize n = file.gcount();
+            for (std::streamsize i = 0; i < n; ++i) {
+                hash ^= static_cast<unsigned char>(buffer[i]);
+                hash *= 1099511628211ull;
+            }
+        }
+        key.hash = hash;
+        return key;
+    }
+};
+
+// Binary image of the entries in config.json, kept as config.snapshot so a
+// launch with an unchanged config skips JSON parsing and UTF-8 conversion.
+//
+// Layout (native byte order, checked via byteOrder):
+//   Header
+//   EntryRecord[entryCount]      offsets/lengths in UTF-16 code units
+//   char16_t strings[stringUnits]
+// The strings are QString's own representation, so EntryStore uses the
+// mapped pages as an arena block as they are.
+class SnapshotCache {
+public:
+    static std::string pathFor(const std::string& configPath) {
+        return std::filesystem::path(configPath).replace_extension(".snapshot").string();
+    }
+
+    // Writes a snapshot of store for the config.json described by key.
+    // Best effort: a failed write only costs the next launch a JSON parse.
+    static bool write(const std::string& path, const SnapshotSourceKey& key, std::uint64_t journalSeq,
+                      const EntryStore& store) {
+        std::uint64_t stringUnits = 0;
+        for (int i = 0; i < store.size(); ++i) {
+            stringUnits += static_cast<std::uint64_t>(store.name(i).length) + store.value(i).length
+                + store.tagText(i).length;
+        }
+        Header header = {};
+        std::memcpy(header.magic, kMagic, sizeof(header.magic));
+        header.version = kVersion;
+        header.byteOrder = kByteOrder;
+        header.entryCount = static_cast<std::uint64_t>(store.size());
+        header.sourceSize = key.size;
+        header.sourceMtime = key.mtime;
+        header.sourceHash = key.hash;
+        header.journalSeq = journalSeq;
+        header.tableOffset = sizeof(Header);
+        header.stringsOffset = header.tableOffset + header.entryCount * sizeof(EntryRecord);
+        header.stringUnits = stringUnits;
+
+        std::string image(static_cast<std::size_t>(header.stringsOffset + stringUnits * sizeof(char16_t)), '\0');
+        std::memcpy(&image[0], &header, sizeof(header));
+        char* table = &image[static_cast<std::size_t>(header.tableOffset)];
+        char* strings = &image[static_cast<std::size_t>(header.stringsOffset)];
+        std::uint64_t cursor = 0;
+        for (int i = 0; i < store.size(); ++i) {
+            EntryText name = store.name(i);
+            EntryText value = store.value(i);
+            EntryText tags = store.tagText(i);
+            EntryRecord record = {};
+            record.id = store.idAt(i);
+            record.nameOffset = cursor;
+            record.nameLength = static_cast<std::uint32_t>(name.length);
+            std::memcpy(strings + cursor * sizeof(char16_t), name.data, record.nameLength * sizeof(char16_t));
+            cursor += record.nameLength;
+            record.valueOffset = cursor;
+            record.valueLength = static_cast<std::uint32_t>(value.length);
+            std::memcpy(strings + cursor * sizeof(char16_t), value.data, record.valueLength * sizeof(char16_t));
+            cursor += record.valueLength;
+            record.tagsOffset = cursor;
+            record.tagsLength = static_cast<std::uint32_t>(tags.length);
+            std::memcpy(strings + cursor * sizeof(char16_t), tags.data, record.tagsLength * sizeof(char16_t));
+            cursor += record.tagsLength;
+            std::memcpy(table + i * sizeof(EntryRecord), &record, sizeof(record));
+        }
+        try {
+            AtomicFile::write(path, image);
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    // Maps the snapshot and appends its entries to store if it was built
+    // from the config.json described by key. The string blob becomes one of
+    // the store's blocks, so entries point straight into the mapped pages.
+    // The mapping is never released: copies of the store may outlive any
+    // owner we could tie it to, and the pages are file-backed so the OS can
+    // reclaim them under memory pressure.
+    static bool map(const std::string& path, const SnapshotSourceKey& key, EntryStore& store,
+                    std::uint64_t& journalSeq) {
+        QFile* file = new QFile(QString::fromStdString(path));
+        if (!file->open(QIODevice::ReadOnly) || file->size() < static_cast<qint64>(sizeof(Header))) {
+            delete file;
+            return false;
+        }
+        const std::uint64_t size = static_cast<std::uint64_t>(file->size());
+        uchar* base = file->map(0, file->size());
+        if (!base) {
+            delete file;
+            return false;
+        }
+        Header header;
+        std::memcpy(&header, base, sizeof(header));
+        bool valid = std::memcmp(header.magic, kMagic, sizeof(header.magic)) == 0
+            && header.version == kVersion
+            && header.byteOrder == kByteOrder
+            && header.sourceSize == key.size
+            && header.sourceMtime == key.mtime
+            && header.sourceHash == key.hash
+            && header.entryCount <= static_cast<std::uint64_t>(INT32_MAX)
+            && header.tableOffset == sizeof(Header)
+            && header.entryCount <= (size - sizeof(Header)) / sizeof(EntryRecord)
+            && header.stringsOffset == header.tableOffset + header.entryCount * sizeof(EntryRecord)
+            && header.stringsOffset % alignof(char16_t) == 0
+            && header.stringsOffset <= size
+            && header.stringUnits <= (size - header.stringsOffset) / sizeof(char16_t)
+            && header.stringUnits <= UINT32_MAX;
+        const EntryRecord* table = reinterpret_cast<const EntryRecord*>(base + header.tableOffset);
+        for (std::uint64_t i = 0; valid && i < header.entryCount; ++i) {
+            const EntryRecord& record = table[i];
+            valid = fits(record.nameOffset, record.nameLength, header.stringUnits)
+                && fits(record.valueOffset, record.valueLength, header.stringUnits)
+                && fits(record.tagsOffset, record.tagsLength, header.stringUnits);
+        }
+        if (!valid) {
+            file->unmap(base);
+            delete file;
+            return false;
+        }
+
+        const char16_t* strings = reinterpret_cast<const char16_t*>(base + header.stringsOffset);
+        std::uint32_t block = store.adoptBlock(std::shared_ptr<const char16_t>(strings, [](const char16_t*) {}));
+        store.reserve(store.size() + static_cast<int>(header.entryCount));
+        for (std::uint64_t i = 0; i < header.entryCount; ++i) {
+            const EntryRecord& record = table[i];
+            store.appendView(record.id, block, static_cast<std::uint32_t>(record.nameOffset), record.nameLength,
+                             static_cast<std::uint32_t>(record.valueOffset), record.valueLength,
+                             static_cast<std::uint32_t>(record.tagsOffset), record.tagsLength);
+        }
+        journalSeq = header.journalSeq;
+        return true; // file stays open and mapped; see above.
+    }
+
+private:
+    // Whether [offset, offset + length) lies within units, without the sum
+    // wrapping around for a corrupt offset.
+    static bool fits(std::uint64_t offset, std::uint32_t length, std::uint64_t units) {
+        return length <= units && offset <= units - length;
+    }
+
+    static constexpr char kMagic[8] = {'E', 'I', 'D', 'S', 'N', 'A', 'P', '\0'};
+    static constexpr std::uint32_t kVersion = 3;
+    static constexpr std::uint32_t kByteOrder = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint64_t entryCount;
+        std::uint64_t sourceSize;
+        std::int64_t sourceMtime;
+        std::uint64_t sourceHash;
+        std::uint64_t journalSeq;
+        std::uint64_t tableOffset;
+        std::uint64_t stringsOffset;
+        std::uint64_t stringUnits;
+    };
+
+    struct EntryRecord {
+        std::uint64_t id;
+        std::uint64_t nameOffset;
+        std::uint32_t nameLength;
+        std::uint32_t valueLength;
+        std::uint64_t valueOffset;
+        std::uint64_t tagsOffset; // Tags joined by EntryStore::tagSeparator
+        std::uint32_t tagsLength;
+        std::uint32_t reserved;
+    };
+};
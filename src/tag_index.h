@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "entry_store.h"
+#include "roaring_bitmap.h"
+#include "search_key.h"
+
+// Entry IDs per tag, as RoaringBitmaps, so a tag filter such as
+// "work email -old" is a couple of bitmap intersections and a subtraction
+// however large the library is. Tags are compared by their SearchKey.
+//
+// Like the other indexes it is kept up to date entry by entry: add()
+// replaces what an ID was tagged with, remove() drops it, and a tag whose
+// last entry goes away is forgotten.
+class TagIndex {
+public:
+    using EntryId = EntryStore::EntryId;
+
+    // SearchKeys of the tags of the entry at row, without repeats.
+    static std::vector<std::string> keysOf(const EntryStore& store, int row) {
+        std::vector<std::string> keys;
+        store.forEachTag(row, [&](EntryText tag) {
+            std::string key = SearchKey::fold(tag);
+            if (!key.empty() && std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                keys.push_back(std::move(key));
+            }
+        });
+        return keys;
+    }
+
+    void clear() { *this = TagIndex(); }
+
+    std::size_t tagCount() const { return byTag.size(); }
+
+    // Records id with tags keys, replacing what it was tagged with before.
+    void add(EntryId id, std::vector<std::string> keys) {
+        remove(id);
+        everyone.add(id);
+        if (keys.empty()) {
+            return;
+        }
+        for (const std::string& key : keys) {
+            byTag[key].add(id);
+        }
+        tagsOf[id] = std::move(keys);
+    }
+
+    void remove(EntryId id) {
+        if (!everyone.remove(id)) {
+            return;
+        }
+        auto it = tagsOf.find(id);
+        if (it == tagsOf.end()) {
+            return;
+        }
+        for (const std::string& key : it->second) {
+            auto tag = byTag.find(key);
+            tag->second.remove(id);
+            if (tag->second.isEmpty()) {
+                byTag.erase(tag);
+            }
+        }
+        tagsOf.erase(it);
+    }
+
+    // Entries tagged with key, or null if none are.
+    const RoaringBitmap* find(const std::string& key) const {
+        auto it = byTag.find(key);
+        return it == byTag.end() ? nullptr : &it->second;
+    }
+
+    // Entries tagged with every key in include and none in exclude. With
+    // include empty, every entry qualifies before the exclusions.
+    RoaringBitmap select(const std::vector<std::string>& include, const std::vector<std::string>& exclude) const {
+        std::vector<const RoaringBitmap*> required;
+        for (const std::string& key : include) {
+            const RoaringBitmap* bitmap = find(key);
+            if (!bitmap) {
+                return RoaringBitmap();
+            }
+            required.push_back(bitmap);
+        }
+        // Smallest first, so every later intersection is at most that big.
+        std::sort(required.begin(), required.end(), [](const RoaringBitmap* a, const RoaringBitmap* b) {
+            return a->cardinality() < b->cardinality();
+        });
+        RoaringBitmap result = required.empty() ? everyone : *required.front();
+        for (std::size_t i = 1; i < required.size() && !result.isEmpty(); ++i) {
+            result = RoaringBitmap::intersect(result, *required[i]);
+        }
+        for (const std::string& key : exclude) {
+            const RoaringBitmap* bitmap = find(key);
+            if (bitmap && !result.isEmpty()) {
+                result = RoaringBitmap::subtract(result, *bitmap);
+            }
+        }
+        return result;
+    }
+
+private:
+    std::unordered_map<std::string, RoaringBitmap> byTag;
+    std::unordered_map<EntryId, std::vector<std::string>> tagsOf; // Tagged entries only
+    RoaringBitmap everyone; // Every indexed entry, tagged or not
+};
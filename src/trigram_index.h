@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "entry_store.h"
+#include "fuzzy_matcher.h"
+
+// Inverted index from trigrams (three bytes of a SearchKey) to the entries
+// whose name or value contains them, for case-insensitive substring search.
+//
+// Each entry is a document holding the search keys of its name and value
+// as "name\0value" in one contiguous buffer; they are made when the entry
+// is indexed and only replaced when it changes. Every engine matches
+// against this buffer, byte by byte. A query of three or more characters intersects the
+// posting lists of its trigrams, smallest first, and only the surviving
+// candidates are checked against the text; shorter queries scan the
+// buffer. Posting lists stay sorted because documents are only appended:
+// replacing or removing an entry leaves a dead document behind, and the
+// index compacts itself once dead documents outnumber live ones.
+class TrigramIndex {
+public:
+    using EntryId = EntryStore::EntryId;
+
+    void clear() { *this = TrigramIndex(); }
+
+    std::size_t size() const { return docOf.size(); }
+
+    // Indexes an entry by the SearchKey of its name and value, replacing
+    // what was indexed under id before.
+    void add(EntryId id, std::string_view nameKey, std::string_view valueKey) {
+        remove(id);
+        Doc doc;
+        doc.id = id;
+        doc.offset = text.size();
+        text.append(nameKey);
+        doc.nameLength = nameKey.size();
+        text.push_back('\0');
+        text.append(valueKey);
+        doc.length = text.size() - doc.offset;
+        doc.mask = FuzzyMatcher::charMask(text.data() + doc.offset, doc.length);
+        std::uint32_t number = static_cast<std::uint32_t>(docs.size());
+        docs.push_back(doc);
+        docOf[id] = number;
+        indexDoc(number);
+    }
+
+    void remove(EntryId id) {
+        auto it = docOf.find(id);
+        if (it == docOf.end()) {
+            return;
+        }
+        docs[it->second].live = false;
+        docOf.erase(it);
+        ++deadDocs;
+        if (deadDocs > 1024 && deadDocs > docOf.size()) {
+            compact();
+        }
+    }
+
+    // IDs of the entries whose name or value contains needle, a folded
+    // query (see SearchKey), in the order they were indexed.
+    std::vector<EntryId> find(const std::string& needle) const {
+        std::vector<EntryId> result;
+        if (needle.empty()) {
+            return result;
+        }
+        if (needle.size() < 3) {
+            scan(needle, 0, docs.size(), result);
+            return result;
+        }
+        // A posting list is exact for its own trigram.
+        const bool exact = needle.size() == 3;
+        for (std::uint32_t number : candidates(needle)) {
+            const Doc& doc = docs[number];
+            if (doc.live && (exact || contains(text.data() + doc.offset, doc.length, needle))) {
+                result.push_back(doc.id);
+            }
+        }
+        return result;
+    }
+
+    // Upper bound on the number of documents containing needle: the length
+    // of its rarest trigram's posting list, dead documents included, or
+    // docCount() for a needle too short to have a trigram.
+    std::size_t estimate(const std::string& needle) const {
+        std::size_t best = docs.size();
+        for (std::size_t i = 0; i + 3 <= needle.size(); ++i) {
+            auto it = postings.find(trigram(needle.data() + i));
+            if (it == postings.end()) {
+                return 0;
+            }
+            best = std::min(best, it->second.size());
+        }
+        return best;
+    }
+
+    // Appends to out the IDs of documents [begin, end) whose text contains
+    // needle, checking each one; find() without the posting lists.
+    void scan(const std::string& needle, std::size_t begin, std::size_t end,
+              std::vector<EntryId>& out) const {
+        for (std::size_t number = begin; number < end; ++number) {
+            const Doc& doc = docs[number];
+            if (doc.live && contains(text.data() + doc.offset, doc.length, needle)) {
+                out.push_back(doc.id);
+            }
+        }
+    }
+
+    // Document numbers run from 0 to docCount(), dead documents included;
+    // they address the ranges taken by scan(), forEachIn() and chunks().
+    std::size_t docCount() const { return docs.size(); }
+
+    // Splits the documents into consecutive ranges of about bytes of text
+    // each, so a range's text stays in a core's cache.
+    std::vector<std::pair<std::size_t, std::size_t>> chunks(std::size_t bytes) const {
+        std::vector<std::pair<std::size_t, std::size_t>> result;
+        std::size_t begin = 0;
+        std::size_t chunkText = 0;
+        for (std::size_t number = 0; number < docs.size(); ++number) {
+            chunkText += docs[number].length + 1;
+            if (chunkText >= bytes) {
+                result.emplace_back(begin, number + 1);
+                begin = number + 1;
+                chunkText = 0;
+            }
+        }
+        if (begin < docs.size()) {
+            result.emplace_back(begin, docs.size());
+        }
+        return result;
+    }
+
+    // Whether the indexed name or value of id contains the folded needle.
+    bool contains(EntryId id, const std::string& needle) const {
+        auto it = docOf.find(id);
+        if (it == docOf.end()) {
+            return false;
+        }
+        const Doc& doc = docs[it->second];
+        return contains(text.data() + doc.offset, doc.length, needle);
+    }
+
+    // Calls f(id, name, value, mask) for every indexed entry, with name and
+    // value as their search keys and mask as FuzzyMatcher::charMask() of both.
+    template <typename F>
+    void forEach(F&& f) const {
+        for (const Doc& doc : docs) {
+            if (doc.live) {
+                visitDoc(doc, f);
+            }
+        }
+    }
+
+    // Like forEach() for the live documents in [begin, end) only.
+    template <typename F>
+    void forEachIn(std::size_t begin, std::size_t end, F&& f) const {
+        for (std::size_t number = begin; number < end; ++number) {
+            if (docs[number].live) {
+                visitDoc(docs[number], f);
+            }
+        }
+    }
+
+    // Like forEach() for the given IDs only; unknown IDs are skipped.
+    template <typename F>
+    void forEach(const std::vector<EntryId>& ids, F&& f) const {
+        for (EntryId id : ids) {
+            auto it = docOf.find(id);
+            if (it != docOf.end()) {
+                visitDoc(docs[it->second], f);
+            }
+        }
+    }
+
+private:
+    struct Doc {
+        EntryId id = 0;
+        std::size_t offset = 0;
+        std::size_t length = 0;
+        std::size_t nameLength = 0;
+        std::uint64_t mask = 0;
+        bool live = true;
+    };
+
+    template <typename F>
+    void visitDoc(const Doc& doc, F& f) const {
+        const char* p = text.data() + doc.offset;
+        f(doc.id, std::string_view(p, doc.nameLength),
+          std::string_view(p + doc.nameLength + 1, doc.length - doc.nameLength - 1), doc.mask);
+    }
+
+    static bool contains(const char* hay, std::size_t length, const std::string& needle) {
+        return std::string_view(hay, length).find(needle) != std::string_view::npos;
+    }
+
+    static std::uint32_t trigram(const char* p) {
+        return (static_cast<std::uint32_t>(static_cast<unsigned char>(p[0])) << 16)
+            | (static_cast<std::uint32_t>(static_cast<unsigned char>(p[1])) << 8) | static_cast<unsigned char>(p[2]);
+    }
+
+    void indexDoc(std::uint32_t number) {
+        const Doc& doc = docs[number];
+        if (doc.length < 3) {
+            return;
+        }
+        scratch.clear();
+        const char* p = text.data() + doc.offset;
+        for (std::size_t i = 0; i + 3 <= doc.length; ++i) {
+            scratch.push_back(trigram(p + i));
+        }
+        std::sort(scratch.begin(), scratch.end());
+        scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+        for (std::uint32_t key : scratch) {
+            postings[key].push_back(number);
+        }
+    }
+
+    // Documents containing every trigram of needle, ascending.
+    std::vector<std::uint32_t> candidates(const std::string& needle) const {
+        std::vector<const std::vector<std::uint32_t>*> lists;
+        for (std::size_t i = 0; i + 3 <= needle.size(); ++i) {
+            auto it = postings.find(trigram(needle.data() + i));
+            if (it == postings.end()) {
+                return {};
+            }
+            lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+        lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+        std::vector<std::uint32_t> result = *lists.front();
+        std::vector<std::uint32_t> next;
+        for (std::size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+            next.clear();
+            std::set_intersection(result.begin(), result.end(), lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(next));
+            result.swap(next);
+        }
+        return result;
+    }
+
+    // Drops dead documents and their text, renumbering the live ones.
+    void compact() {
+        TrigramIndex fresh;
+        fresh.docs.reserve(docOf.size());
+        for (const Doc& doc : docs) {
+            if (!doc.live) {
+                continue;
+            }
+            Doc copy = doc;
+            copy.offset = fresh.text.size();
+            fresh.text.append(text, doc.offset, doc.length);
+            std::uint32_t number = static_cast<std::uint32_t>(fresh.docs.size());
+            fresh.docs.push_back(copy);
+            fresh.docOf[doc.id] = number;
+            fresh.indexDoc(number);
+        }
+        *this = std::move(fresh);
+    }
+
+    std::vector<Doc> docs;
+    std::string text; // Keys "name\0value" of every document, back to back
+    std::unordered_map<EntryId, std::uint32_t> docOf; // Live documents only
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings;
+    std::size_t deadDocs = 0;
+    std::vector<std::uint32_t> scratch;
+};
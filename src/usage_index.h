@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "entry_store.h"
+
+// How much each entry has been used, weighted towards recent use
+// ("frecency"), in an indexed max-heap.
+//
+// Every use adds one to an entry's score, and scores halve every halfLife
+// seconds. Instead of decaying all scores as time passes, each is kept as
+// the base-2 logarithm of what it was worth at time 0,
+// key = log2(sum of 2^(t / halfLife)) over its uses at times t, so keys
+// order entries the same at any time and the score now is
+// 2^(key - now / halfLife). A use therefore only raises one key and
+// repairs the heap along one path, O(log n); removing an entry is
+// O(log n) too, and nothing is ever rescanned.
+class UsageIndex {
+public:
+    using EntryId = EntryStore::EntryId;
+
+    static constexpr double halfLife = 7 * 24 * 3600.0; // Seconds
+
+    struct Record {
+        EntryId id = 0;
+        double key = 0.0;
+        std::uint32_t uses = 0;
+    };
+
+    // Seconds since the epoch, the clock uses are recorded by.
+    static double currentTime() {
+        return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    bool isEmpty() const { return heap.empty(); }
+    std::size_t size() const { return heap.size(); }
+
+    void clear() {
+        heap.clear();
+        position.clear();
+    }
+
+    // Notes a use of id at now, in seconds since the epoch.
+    void record(EntryId id, double now) { merge({id, now / halfLife, 1}); }
+
+    // Adds record's uses to what id already has, e.g. when counters saved
+    // earlier are loaded after the session has recorded uses of its own.
+    void merge(const Record& record) {
+        auto it = position.find(record.id);
+        if (it == position.end()) {
+            position.emplace(record.id, heap.size());
+            heap.push_back(record);
+            siftUp(heap.size() - 1);
+            return;
+        }
+        Record& existing = heap[it->second];
+        existing.key = logAdd(existing.key, record.key);
+        existing.uses += record.uses;
+        siftUp(it->second);
+    }
+
+    void remove(EntryId id) {
+        auto it = position.find(id);
+        if (it == position.end()) {
+            return;
+        }
+        std::size_t at = it->second;
+        position.erase(it);
+        if (at + 1 != heap.size()) {
+            heap[at] = heap.back();
+            position[heap[at].id] = at;
+            heap.pop_back();
+            siftDown(siftUp(at));
+        } else {
+            heap.pop_back();
+        }
+    }
+
+    std::uint32_t uses(EntryId id) const {
+        auto it = position.find(id);
+        return it == position.end() ? 0 : heap[it->second].uses;
+    }
+
+    // The decayed score of id at now; 0 if it was never used.
+    double score(EntryId id, double now) const {
+        auto it = position.find(id);
+        return it == position.end() ? 0.0 : std::exp2(heap[it->second].key - now / halfLife);
+    }
+
+    // Calls f(record) for up to limit entries, highest score first, in
+    // O(limit log limit) by walking the heap from the top.
+    template <typename F>
+    void forEachBest(std::size_t limit, F&& f) const {
+        auto lower = [this](std::size_t a, std::size_t b) { return heap[a].key < heap[b].key; };
+        std::vector<std::size_t> frontier;
+        if (!heap.empty()) {
+            frontier.push_back(0);
+        }
+        for (std::size_t emitted = 0; emitted < limit && !frontier.empty(); ++emitted) {
+            std::pop_heap(frontier.begin(), frontier.end(), lower);
+            std::size_t at = frontier.back();
+            frontier.pop_back();
+            f(heap[at]);
+            for (std::size_t child = 2 * at + 1; child <= 2 * at + 2 && child < heap.size(); ++child) {
+                frontier.push_back(child);
+                std::push_heap(frontier.begin(), frontier.end(), lower);
+            }
+        }
+    }
+
+    // Every record, in no particular order.
+    const std::vector<Record>& records() const { return heap; }
+
+private:
+    // log2(2^a + 2^b) without overflowing for large keys.
+    static double logAdd(double a, double b) {
+        double high = std::max(a, b);
+        double low = std::min(a, b);
+        return high + std::log2(1.0 + std::exp2(low - high));
+    }
+
+    void place(std::size_t at, const Record& record) {
+        heap[at] = record;
+        position[record.id] = at;
+    }
+
+    std::size_t siftUp(std::size_t at) {
+        Record moving = heap[at];
+        while (at > 0) {
+            std::size_t parent = (at - 1) / 2;
+            if (heap[parent].key >= moving.key) {
+                break;
+            }
+            place(at, heap[parent]);
+            at = parent;
+        }
+        place(at, moving);
+        return at;
+    }
+
+    void siftDown(std::size_t at) {
+        Record moving = heap[at];
+        for (;;) {
+            std::size_t child = 2 * at + 1;
+            if (child >= heap.size()) {
+                break;
+            }
+            if (child + 1 < heap.size() && heap[child + 1].key > heap[child].key) {
+                ++child;
+            }
+            if (heap[child].key <= moving.key) {
+                break;
+            }
+            place(at, heap[child]);
+            at = child;
+        }
+        place(at, moving);
+    }
+
+    std::vector<Record> heap; // Max-heap by key
+    std::unordered_map<EntryId, std::size_t> position; // ID -> index in heap
+};